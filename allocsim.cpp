@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <unistd.h> // for optind
+
+#include "fsalloc.hpp"
+
+// Run a benchmark or replay a trace against several strategies in one
+// process: allocsim.out [options] [strategy...]. The options are the
+// simulators' own; the strategies default to the five single-threaded ones.
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0)
+    {
+        return 1;
+    }
+    if (options.workload == -1 && options.traceFile == nullptr)
+    {
+        std::fprintf(stderr, "%s needs a workload (-w) or a trace (-t)\n", argv[0]);
+        return 1;
+    }
+
+    const char *everyStrategy[] = {"sequential", "linked", "linked-fat", "indexed", "inode"};
+    const char *const *names = everyStrategy;
+    int count = sizeof(everyStrategy) / sizeof(everyStrategy[0]);
+    if (optind < argc)
+    {
+        names = argv + optind;
+        count = argc - optind;
+    }
+
+    int status = 0;
+    for (int i = 0; i < count; i++)
+    {
+        // Made and dropped one at a time, as they share the device model
+        std::unique_ptr<fsalloc::Allocator> allocator = fsalloc::makeAllocator(names[i], options);
+        if (allocator == nullptr)
+        {
+            status = 1;
+            continue;
+        }
+        if (options.workload != -1)
+        {
+            if (allocator->runBenchmark(options) != 0)
+                status = 1;
+        }
+        else
+        {
+            std::printf("\n%s\n", allocator->name());
+            if (allocator->replayTrace(options.traceFile) != 0)
+                status = 1;
+        }
+    }
+    return status;
+}
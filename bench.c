@@ -0,0 +1,274 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h> // for getrusage
+
+#include "bench.h"
+#include "buffer-cache.h"
+#include "readahead.h"
+#include "console.h"
+#include "device.h"
+#include "metrics.h"
+#include "workload.h"
+
+#define CSV_HEADER "strategy,workload,blocks,block_size,fill_percent,operations,failed," \
+                   "ns_per_op,blocks_scanned_per_op,metadata_bytes,max_rss_kb,device,device_ms_per_op,threads," \
+                   "cache,cache_hit_ratio,cache_evictions,ms_per_block_read," \
+                   "readahead,readahead_hit_ratio,hidden_ms_per_op,prefetch_ms_per_block," \
+                   "image_read_mb_per_s,image_write_mb_per_s\n"
+
+static long maxResidentKilobytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == -1)
+        return 0;
+    return usage.ru_maxrss; // Kilobytes on Linux
+}
+
+// Run the selected synthetic workload against one strategy and write a CSV
+// row. Only the measured phase is timed: the fill itself for "fill", the
+// operations after the fill for every other workload.
+int runBenchmark(const char *strategy, const struct TraceHandlers *handlers,
+                 size_t (*metadataBytes)(void), const struct SimOptions *options)
+{
+    struct Workload workload;
+    if (workloadInit(&workload, options->workload, options->blockCount, options->fillPercent, options->benchOperations) == -1)
+    {
+        fprintf(stderr, "Out of memory for the workload\n");
+        return -1;
+    }
+
+    struct ReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    struct TraceOp op;
+    int measuring = options->workload == WORKLOAD_FILL;
+    unsigned long long scannedAtStart = blocksScanned;
+    struct DeviceSample deviceAtStart;
+    deviceSample(&device, &deviceAtStart);
+
+    consoleQuiet = 1;
+    double start = wallSeconds();
+    while (workloadNext(&workload, &op))
+    {
+        if (!measuring && !workload.filling)
+        {
+            measuring = 1;
+            memset(&stats, 0, sizeof(stats));
+            scannedAtStart = blocksScanned;
+            deviceSample(&device, &deviceAtStart);
+            start = wallSeconds();
+        }
+        int result = applyTraceOp(handlers, &op, &stats);
+        workloadResult(&workload, &op, result);
+    }
+    stats.seconds = wallSeconds() - start;
+    stats.deviceMs = device.clockMs - deviceAtStart.clockMs;
+    consoleQuiet = 0;
+    workloadDestroy(&workload);
+
+    return reportBenchmark(strategy, options, 1, &stats, blocksScanned - scannedAtStart, metadataBytes(), &deviceAtStart);
+}
+
+// One thread of runConcurrentBenchmark
+struct BenchThread
+{
+    pthread_t thread;
+    int index;
+    const struct TraceHandlers *handlers;
+    void (*threadFlush)(void);
+    const struct SimOptions *options;
+    struct ReplayStats stats;
+    int failed; // Out of memory for the workload
+};
+
+// The workers and the timing thread meet at fillDone after the fill, then
+// at measureStart once the timing thread has sampled the counters
+static pthread_barrier_t fillDone, measureStart;
+
+static void waitForMeasuredPhase()
+{
+    pthread_barrier_wait(&fillDone);
+    pthread_barrier_wait(&measureStart);
+}
+
+static void *runBenchThread(void *argument)
+{
+    struct BenchThread *self = argument;
+    const struct SimOptions *options = self->options;
+    struct Workload workload;
+    int measuring = options->workload == WORKLOAD_FILL;
+    if (workloadInit(&workload, options->workload, options->blockCount / options->threads, options->fillPercent,
+                     options->benchOperations / options->threads) == -1)
+    {
+        self->failed = 1;
+        if (!measuring)
+            waitForMeasuredPhase();
+        return NULL;
+    }
+    workload.seed ^= self->index * 0x9E3779B97F4A7C15ULL; // Thread 0 sees the single-threaded stream
+
+    struct TraceOp op, named;
+    while (workloadNext(&workload, &op))
+    {
+        if (!measuring && !workload.filling)
+        {
+            measuring = 1;
+            memset(&self->stats, 0, sizeof(self->stats));
+            if (self->threadFlush != NULL)
+                self->threadFlush();
+            waitForMeasuredPhase();
+        }
+        // Each thread works on its own files
+        named = op;
+        snprintf(named.name, TRACE_NAME_MAX, "t%d.%.40s", self->index, op.name);
+        int result = applyTraceOp(self->handlers, &named, &self->stats);
+        workloadResult(&workload, &op, result);
+    }
+    if (!measuring)
+        waitForMeasuredPhase();
+    workloadDestroy(&workload);
+    if (self->threadFlush != NULL)
+        self->threadFlush();
+    return NULL;
+}
+
+// runBenchmark for thread-safe handlers: options->threads threads each run
+// the workload on their own share of the disk and of the operations, with
+// their own file names. All threads fill first; the measured phase starts
+// when the last one is done filling. 'threadFlush' runs in each thread as it
+// finishes filling and again as it finishes, to hand back per-thread state
+// and add the blocks it scanned to blocksScanned.
+int runConcurrentBenchmark(const char *strategy, const struct TraceHandlers *handlers, size_t (*metadataBytes)(void),
+                           void (*threadFlush)(void), const struct SimOptions *options)
+{
+    int threads = options->threads;
+    struct BenchThread workers[threads];
+    memset(workers, 0, sizeof(workers));
+    pthread_barrier_init(&fillDone, NULL, threads + 1);
+    pthread_barrier_init(&measureStart, NULL, threads + 1);
+
+    consoleQuiet = 1;
+    unsigned long long scannedAtStart = blocksScanned;
+    double start = wallSeconds();
+    int started = 0;
+    for (; started < threads; started++)
+    {
+        workers[started].index = started;
+        workers[started].handlers = handlers;
+        workers[started].threadFlush = threadFlush;
+        workers[started].options = options;
+        if (pthread_create(&workers[started].thread, NULL, runBenchThread, &workers[started]) != 0)
+            break;
+    }
+    if (started < threads)
+    {
+        // The barrier can never fill; nothing has been measured yet
+        fprintf(stderr, "Could not start %d threads\n", threads);
+        exit(1);
+    }
+    if (options->workload != WORKLOAD_FILL)
+    {
+        pthread_barrier_wait(&fillDone);
+        scannedAtStart = __atomic_load_n(&blocksScanned, __ATOMIC_RELAXED);
+        start = wallSeconds();
+        pthread_barrier_wait(&measureStart);
+    }
+    struct ReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int failed = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        failed |= workers[i].failed;
+        for (int type = 0; type < TRACE_OP_TYPES; type++)
+        {
+            stats.count[type] += workers[i].stats.count[type];
+            stats.failed[type] += workers[i].stats.failed[type];
+        }
+    }
+    stats.seconds = wallSeconds() - start;
+    consoleQuiet = 0;
+    pthread_barrier_destroy(&fillDone);
+    pthread_barrier_destroy(&measureStart);
+    if (failed)
+    {
+        fprintf(stderr, "Out of memory for the workload\n");
+        return -1;
+    }
+
+    return reportBenchmark(strategy, options, threads, &stats, blocksScanned - scannedAtStart, metadataBytes(), NULL);
+}
+
+// Write the CSV row for a measured phase: 'stats' holds its operations, wall
+// and device time, 'scanned' the blocks it scanned, and 'deviceStart' the
+// device counters when it began (NULL if the strategy skips the device).
+int reportBenchmark(const char *strategy, const struct SimOptions *options, int threads,
+                    const struct ReplayStats *stats, unsigned long long scanned, size_t metadataBytes,
+                    const struct DeviceSample *deviceStart)
+{
+    long long operations = replayTotal(stats);
+    long long failed = 0;
+    for (int type = 0; type < TRACE_OP_TYPES; type++)
+        failed += stats->failed[type];
+    double nsPerOp = operations > 0 ? stats->seconds * 1e9 / operations : 0;
+    double scannedPerOp = operations > 0 ? (double)scanned / operations : 0;
+    double deviceMsPerOp = operations > 0 ? stats->deviceMs / operations : 0;
+
+    char cache[32] = "none";
+    double hitRatio = 0, msPerRead = 0;
+    long long evictions = 0;
+    double readaheadHitRatio = 0, hiddenMsPerOp = 0, prefetchMsPerBlock = 0;
+    double imageReadRate = 0, imageWriteRate = 0;
+    if (deviceStart != NULL)
+    {
+        struct DeviceSample now;
+        deviceSample(&device, &now);
+        long long lookups = (now.cacheHits - deviceStart->cacheHits) + (now.cacheMisses - deviceStart->cacheMisses);
+        long long requests = now.readRequests - deviceStart->readRequests;
+        hitRatio = lookups > 0 ? (double)(now.cacheHits - deviceStart->cacheHits) / lookups : 0;
+        evictions = now.cacheEvictions - deviceStart->cacheEvictions;
+        msPerRead = requests > 0 ? (now.readMs - deviceStart->readMs) / requests : 0;
+        long long prefetched = now.prefetched - deviceStart->prefetched;
+        readaheadHitRatio = requests > 0 ? (double)(now.prefetchHits - deviceStart->prefetchHits) / requests : 0;
+        hiddenMsPerOp = operations > 0 ? (now.hiddenMs - deviceStart->hiddenMs) / operations : 0;
+        prefetchMsPerBlock = prefetched > 0 ? (now.prefetchMs - deviceStart->prefetchMs) / prefetched : 0;
+        double readSeconds = now.imageReadSeconds - deviceStart->imageReadSeconds;
+        double writeSeconds = now.imageWriteSeconds - deviceStart->imageWriteSeconds;
+        imageReadRate = readSeconds > 0 ? (now.imageReadBytes - deviceStart->imageReadBytes) / readSeconds / 1e6 : 0;
+        imageWriteRate =
+            writeSeconds > 0 ? (now.imageWriteBytes - deviceStart->imageWriteBytes) / writeSeconds / 1e6 : 0;
+        if (device.cache != NULL)
+            snprintf(cache, sizeof(cache), "%s-%d", cachePolicyName(device.cache->policy), device.cache->capacity);
+    }
+
+    FILE *output = stdout;
+    if (options->benchOutput != NULL)
+    {
+        output = fopen(options->benchOutput, "a");
+        if (output == NULL)
+        {
+            perror(options->benchOutput);
+            return -1;
+        }
+        fseek(output, 0, SEEK_END);
+    }
+    static int headerPrinted = 0; // Programs running several strategies print one table
+    if ((output == stdout && !headerPrinted) || (output != stdout && ftell(output) == 0)) // Header only for a new file
+        fputs(CSV_HEADER, output);
+    if (output == stdout)
+        headerPrinted = 1;
+    fprintf(output, "%s,%s,%d,%d,%d,%lld,%lld,%.1f,%.2f,%zu,%ld,%s,%.4f,%d,%s,%.4f,%lld,%.4f,%d,%.4f,%.4f,%.4f,%.1f,%.1f\n",
+            strategy, workloadName(options->workload), device.blockCount, device.blockSize,
+            options->fillPercent, operations, failed, nsPerOp, scannedPerOp,
+            metadataBytes, maxResidentKilobytes(), deviceName(device.kind), deviceMsPerOp, threads, cache, hitRatio,
+            evictions, msPerRead, readahead.maxWindow, readaheadHitRatio, hiddenMsPerOp, prefetchMsPerBlock,
+            imageReadRate, imageWriteRate);
+    if (output != stdout)
+    {
+        fclose(output);
+        printf("%s/%s: %lld ops, %.1f ns/op, results appended to %s\n",
+               strategy, workloadName(options->workload), operations, nsPerOp, options->benchOutput);
+    }
+    return 0;
+}
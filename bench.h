@@ -0,0 +1,26 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+#include "device.h"
+#include "options.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int runBenchmark(const char *strategy, const struct TraceHandlers *handlers,
+                 size_t (*metadataBytes)(void), const struct SimOptions *options);
+int runConcurrentBenchmark(const char *strategy, const struct TraceHandlers *handlers, size_t (*metadataBytes)(void),
+                           void (*threadFlush)(void), const struct SimOptions *options);
+int reportBenchmark(const char *strategy, const struct SimOptions *options, int threads,
+                    const struct ReplayStats *stats, unsigned long long scanned, size_t metadataBytes,
+                    const struct DeviceSample *deviceStart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+
+#include "bitmap.h"
+#include "metrics.h"
+
+// Allocate a bitmap with every bit clear. Returns -1 if out of memory.
+int bitmapInit(struct Bitmap *bitmap, int bitCount)
+{
+    bitmap->bitCount = bitCount;
+    bitmap->wordCount = (bitCount + 63) / 64;
+    bitmap->words = calloc(bitmap->wordCount > 0 ? bitmap->wordCount : 1, sizeof(uint64_t));
+    return bitmap->words != NULL ? 0 : -1;
+}
+
+void bitmapDestroy(struct Bitmap *bitmap)
+{
+    free(bitmap->words);
+    bitmap->words = NULL;
+    bitmap->bitCount = 0;
+    bitmap->wordCount = 0;
+}
+
+// Mask of the bits [start, end) that fall inside word 'word'
+static uint64_t rangeMask(int word, int start, int end)
+{
+    int low = start > word * 64 ? start - word * 64 : 0;
+    int high = end < (word + 1) * 64 ? end - word * 64 : 64;
+    uint64_t mask = high == 64 ? ~0ULL : (1ULL << high) - 1;
+    return mask & (~0ULL << low);
+}
+
+void bitmapSetRange(struct Bitmap *bitmap, int start, int count)
+{
+    int end = start + count;
+    for (int word = start >> 6; count > 0 && word <= (end - 1) >> 6; word++)
+    {
+        bitmap->words[word] |= rangeMask(word, start, end);
+    }
+}
+
+void bitmapClearRange(struct Bitmap *bitmap, int start, int count)
+{
+    int end = start + count;
+    for (int word = start >> 6; count > 0 && word <= (end - 1) >> 6; word++)
+    {
+        bitmap->words[word] &= ~rangeMask(word, start, end);
+    }
+}
+
+// First clear bit at or after 'from', or -1. Full words are skipped whole and
+// the free bit inside a word is found with count-trailing-zeros.
+int bitmapFindClear(const struct Bitmap *bitmap, int from)
+{
+    if (from < 0)
+        from = 0;
+    if (from >= bitmap->bitCount)
+        return -1;
+
+    int word = from >> 6;
+    uint64_t bits = ~bitmap->words[word] & (~0ULL << (from & 63));
+    blocksScanned += 64; // Every word examined covers 64 blocks
+    while (bits == 0)
+    {
+        if (++word >= bitmap->wordCount)
+            return -1;
+        blocksScanned += 64;
+        bits = ~bitmap->words[word];
+    }
+
+    int bit = word * 64 + __builtin_ctzll(bits);
+    return bit < bitmap->bitCount ? bit : -1; // Padding bits past the end read as clear
+}
+
+// First set bit at or after 'from', or -1
+int bitmapFindSet(const struct Bitmap *bitmap, int from)
+{
+    if (from < 0)
+        from = 0;
+    if (from >= bitmap->bitCount)
+        return -1;
+
+    int word = from >> 6;
+    uint64_t bits = bitmap->words[word] & (~0ULL << (from & 63));
+    blocksScanned += 64; // Every word examined covers 64 blocks
+    while (bits == 0)
+    {
+        if (++word >= bitmap->wordCount)
+            return -1;
+        blocksScanned += 64;
+        bits = bitmap->words[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+// First set bit in [from, limit), or 'limit' if the range is all clear.
+// Stops scanning at 'limit', so looking for a short run stays cheap on a
+// mostly empty bitmap.
+int bitmapFindSetBefore(const struct Bitmap *bitmap, int from, int limit)
+{
+    if (limit > bitmap->bitCount)
+        limit = bitmap->bitCount;
+    if (from < 0)
+        from = 0;
+    if (from >= limit)
+        return limit;
+
+    int word = from >> 6;
+    int lastWord = (limit - 1) >> 6;
+    uint64_t bits = bitmap->words[word] & (~0ULL << (from & 63));
+    blocksScanned += 64;
+    while (bits == 0)
+    {
+        if (++word > lastWord)
+            return limit;
+        blocksScanned += 64;
+        bits = bitmap->words[word];
+    }
+    int bit = word * 64 + __builtin_ctzll(bits);
+    return bit < limit ? bit : limit;
+}
+
+int bitmapCountSet(const struct Bitmap *bitmap)
+{
+    long long count = 0;
+    for (int word = 0; word < bitmap->wordCount; word++)
+    {
+        count += __builtin_popcountll(bitmap->words[word]);
+    }
+    return (int)count;
+}
+
+// Thread-safe: set up to 'want' clear bits, searching whole words from the
+// one holding 'from' and wrapping round once. Each word is updated with a
+// compare-and-swap, so threads claiming at the same time never get the same
+// bit and never wait for each other. The claimed bits go to 'bits' and the
+// blocks examined are added to *scanned rather than to the shared counter.
+// Returns how many bits were claimed.
+int bitmapClaim(struct Bitmap *bitmap, int from, int *bits, int want, unsigned long long *scanned)
+{
+    int got = 0;
+    int first = from > 0 && from < bitmap->bitCount ? from >> 6 : 0;
+    for (int step = 0; step < bitmap->wordCount && got < want; step++)
+    {
+        int word = (first + step) % bitmap->wordCount;
+        uint64_t valid = ~0ULL; // Padding bits past the end are never handed out
+        if (word == bitmap->wordCount - 1 && (bitmap->bitCount & 63) != 0)
+            valid = (1ULL << (bitmap->bitCount & 63)) - 1;
+
+        uint64_t old = __atomic_load_n(&bitmap->words[word], __ATOMIC_RELAXED);
+        *scanned += 64;
+        while (1)
+        {
+            uint64_t clear = ~old & valid;
+            uint64_t take = 0;
+            for (int n = got; n < want && clear != 0; n++)
+            {
+                take |= clear & -clear; // Lowest clear bit
+                clear &= clear - 1;
+            }
+            if (take == 0)
+                break;
+            // On failure 'old' is reloaded and the bits are picked again
+            if (__atomic_compare_exchange_n(&bitmap->words[word], &old, old | take, 0, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED))
+            {
+                while (take != 0)
+                {
+                    bits[got++] = word * 64 + __builtin_ctzll(take);
+                    take &= take - 1;
+                }
+                break;
+            }
+        }
+    }
+    return got;
+}
+
+// Thread-safe bitmapClear
+void bitmapRelease(struct Bitmap *bitmap, int bit)
+{
+    __atomic_fetch_and(&bitmap->words[bit >> 6], ~(1ULL << (bit & 63)), __ATOMIC_RELEASE);
+}
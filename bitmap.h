@@ -0,0 +1,40 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdint.h>
+
+// One bit per block, 1 = used. Searches examine 64 blocks per step.
+struct Bitmap
+{
+    uint64_t *words;
+    int bitCount;
+    int wordCount;
+};
+
+int bitmapInit(struct Bitmap *bitmap, int bitCount);
+void bitmapDestroy(struct Bitmap *bitmap);
+void bitmapSetRange(struct Bitmap *bitmap, int start, int count);
+void bitmapClearRange(struct Bitmap *bitmap, int start, int count);
+int bitmapFindClear(const struct Bitmap *bitmap, int from);
+int bitmapFindSet(const struct Bitmap *bitmap, int from);
+int bitmapFindSetBefore(const struct Bitmap *bitmap, int from, int limit);
+int bitmapCountSet(const struct Bitmap *bitmap);
+int bitmapClaim(struct Bitmap *bitmap, int from, int *bits, int want, unsigned long long *scanned);
+void bitmapRelease(struct Bitmap *bitmap, int bit);
+
+static inline int bitmapTest(const struct Bitmap *bitmap, int bit)
+{
+    return (bitmap->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+static inline void bitmapSet(struct Bitmap *bitmap, int bit)
+{
+    bitmap->words[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+static inline void bitmapClear(struct Bitmap *bitmap, int bit)
+{
+    bitmap->words[bit >> 6] &= ~(1ULL << (bit & 63));
+}
+
+#endif
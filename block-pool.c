@@ -0,0 +1,85 @@
+#include <stdint.h>
+
+#include "block-pool.h"
+
+int blockPoolInit(struct BlockPool *pool, int blockCount)
+{
+    pool->freeBlocks = blockCount;
+    return bitmapInit(&pool->used, blockCount);
+}
+
+void blockPoolDestroy(struct BlockPool *pool)
+{
+    bitmapDestroy(&pool->used);
+    pool->freeBlocks = 0;
+}
+
+// Threads start their batches at different cursors so their claims land
+// in different words of the bitmap
+void blockBatchInit(struct BlockBatch *batch, int cursor)
+{
+    batch->count = 0;
+    batch->cursor = cursor;
+    batch->scanned = 0;
+}
+
+// A free block for the calling thread, or -1 if the bitmap has none left.
+// Blocks held in other threads' batches are not stolen, so up to
+// 2 * BLOCK_BATCH blocks per thread can be free yet unavailable here.
+int blockPoolTake(struct BlockPool *pool, struct BlockBatch *batch)
+{
+    if (batch->count == 0)
+    {
+        if (__atomic_load_n(&pool->freeBlocks, __ATOMIC_RELAXED) <= 0)
+            return -1; // Don't scan a full bitmap
+        int got = bitmapClaim(&pool->used, batch->cursor, batch->blocks, BLOCK_BATCH, &batch->scanned);
+        if (got == 0)
+            return -1;
+        __atomic_fetch_sub(&pool->freeBlocks, got, __ATOMIC_RELAXED);
+        batch->cursor = batch->blocks[got - 1] + 1;
+        // Hand out the lowest block first
+        for (int i = 0; i < got / 2; i++)
+        {
+            int swap = batch->blocks[i];
+            batch->blocks[i] = batch->blocks[got - 1 - i];
+            batch->blocks[got - 1 - i] = swap;
+        }
+        batch->count = got;
+    }
+    return batch->blocks[--batch->count];
+}
+
+static void returnBlocks(struct BlockPool *pool, struct BlockBatch *batch, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        bitmapRelease(&pool->used, batch->blocks[--batch->count]);
+    }
+    __atomic_fetch_add(&pool->freeBlocks, count, __ATOMIC_RELAXED);
+}
+
+// Free a block into the calling thread's batch, where the thread's next
+// allocation finds it. A full batch returns half its blocks to the bitmap.
+void blockPoolGive(struct BlockPool *pool, struct BlockBatch *batch, int block)
+{
+    if (batch->count == 2 * BLOCK_BATCH)
+        returnBlocks(pool, batch, BLOCK_BATCH);
+    batch->blocks[batch->count++] = block;
+}
+
+// Return every block in the batch, e.g. when its thread finishes
+void blockPoolFlush(struct BlockPool *pool, struct BlockBatch *batch)
+{
+    returnBlocks(pool, batch, batch->count);
+}
+
+// Free blocks the calling thread can still get
+long long blockPoolFree(const struct BlockPool *pool, const struct BlockBatch *batch)
+{
+    return __atomic_load_n(&pool->freeBlocks, __ATOMIC_RELAXED) + batch->count;
+}
+
+size_t blockPoolBytes(const struct BlockPool *pool)
+{
+    return pool->used.wordCount * sizeof(uint64_t);
+}
@@ -0,0 +1,37 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <stddef.h>
+
+#include "bitmap.h"
+
+#define BLOCK_BATCH 64 // Blocks a thread claims from or returns to the bitmap at a time
+
+// Free blocks shared by several threads. The bitmap is only changed with
+// bitmapClaim / bitmapRelease, and each thread allocates from its own batch
+// of blocks, so threads touch the shared state once per BLOCK_BATCH blocks.
+struct BlockPool
+{
+    struct Bitmap used;   // 1 = allocated or held in some thread's batch
+    long long freeBlocks; // Clear bits in 'used', updated atomically
+};
+
+// One thread's private stock of free blocks
+struct BlockBatch
+{
+    int blocks[2 * BLOCK_BATCH];
+    int count;
+    int cursor; // Where the next claim starts searching
+    unsigned long long scanned; // Blocks examined by this thread's claims
+};
+
+int blockPoolInit(struct BlockPool *pool, int blockCount);
+void blockPoolDestroy(struct BlockPool *pool);
+void blockBatchInit(struct BlockBatch *batch, int cursor);
+int blockPoolTake(struct BlockPool *pool, struct BlockBatch *batch);
+void blockPoolGive(struct BlockPool *pool, struct BlockBatch *batch, int block);
+void blockPoolFlush(struct BlockPool *pool, struct BlockBatch *batch);
+long long blockPoolFree(const struct BlockPool *pool, const struct BlockBatch *batch);
+size_t blockPoolBytes(const struct BlockPool *pool);
+
+#endif
@@ -0,0 +1,249 @@
+#define _GNU_SOURCE // O_DIRECT
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block-store.h"
+#include "trace.h"
+
+#define CHUNK_BYTES (1 << 20) // Largest single pread or pwrite
+#define DIRECT_ALIGNMENT 4096
+
+// Open the file at 'path', or create it if there is none. O_EXCL makes
+// sure a file that appears in between is not taken over.
+static int openImage(const char *path, int flags)
+{
+    int fd = open(path, flags);
+    if (fd == -1 && errno == ENOENT)
+        fd = open(path, flags | O_CREAT | O_EXCL, 0644);
+    return fd;
+}
+
+// Open or create the image at 'path' and size it to the disk. An existing
+// file is only used if it is empty or already the size of this disk, so a
+// mistyped path (a FAT image, say) is refused instead of truncated. Returns
+// -1 with a message on stderr if it cannot be used.
+int blockStoreOpen(struct BlockStore *store, const char *path, int blockCount, int blockSize)
+{
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+    store->blockSize = blockSize;
+    store->blockCount = blockCount;
+    store->chunkBlocks = CHUNK_BYTES / blockSize > 0 ? CHUNK_BYTES / blockSize : 1;
+
+#ifdef O_DIRECT
+    if (blockSize % DIRECT_ALIGNMENT == 0)
+    {
+        store->fd = openImage(path, O_RDWR | O_DIRECT);
+        store->direct = store->fd != -1;
+    }
+#endif
+    if (store->fd == -1)
+        store->fd = openImage(path, O_RDWR);
+    if (store->fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+
+    struct stat status;
+    off_t size = (off_t)blockCount * blockSize;
+    if (fstat(store->fd, &status) == -1 || !S_ISREG(status.st_mode))
+    {
+        fprintf(stderr, "%s: not a regular file\n", path);
+        blockStoreClose(store);
+        return -1;
+    }
+    if (status.st_size != 0 && status.st_size != size)
+    {
+        fprintf(stderr, "%s: %lld bytes, not the %lld of a %d-block disk of %d-byte blocks; not overwriting it\n",
+                path, (long long)status.st_size, (long long)size, blockCount, blockSize);
+        blockStoreClose(store);
+        return -1;
+    }
+    if (ftruncate(store->fd, size) == -1)
+    {
+        perror(path);
+        blockStoreClose(store);
+        return -1;
+    }
+
+    size_t bytes = (size_t)store->chunkBlocks * blockSize;
+    store->written = calloc(blockCount, sizeof(unsigned long long));
+    if (posix_memalign((void **)&store->buffer, DIRECT_ALIGNMENT, bytes) != 0 ||
+        posix_memalign((void **)&store->readBuffer, DIRECT_ALIGNMENT, bytes) != 0 || store->written == NULL)
+    {
+        fprintf(stderr, "Not enough memory for the image buffer\n");
+        blockStoreClose(store);
+        return -1;
+    }
+    // Payload every block carries after its stamp
+    for (size_t i = 0; i < bytes; i++)
+    {
+        store->buffer[i] = (unsigned char)(i * 31 + 7);
+    }
+    return 0;
+}
+
+void blockStoreClose(struct BlockStore *store)
+{
+    if (store->fd != -1)
+        close(store->fd);
+    free(store->buffer);
+    free(store->readBuffer);
+    free(store->written);
+    store->fd = -1;
+    store->buffer = NULL;
+    store->readBuffer = NULL;
+    store->written = NULL;
+}
+
+// One pread or pwrite of 'count' blocks from 'start' through 'data'.
+// O_DIRECT is dropped if the file system turns it down at the first I/O.
+static int transfer(struct BlockStore *store, int start, int count, int writing, unsigned char *data)
+{
+    size_t bytes = (size_t)count * store->blockSize;
+    off_t offset = (off_t)start * store->blockSize;
+    while (1)
+    {
+        double begin = wallSeconds();
+        ssize_t done = writing ? pwrite(store->fd, data, bytes, offset) : pread(store->fd, data, bytes, offset);
+        double seconds = wallSeconds() - begin;
+        if (done == (ssize_t)bytes)
+        {
+            if (writing)
+            {
+                store->writeSeconds += seconds;
+                store->writeBytes += done;
+                store->writeCalls++;
+            }
+            else
+            {
+                store->readSeconds += seconds;
+                store->readBytes += done;
+                store->readCalls++;
+            }
+            return 0;
+        }
+        if (done == -1 && errno == EINVAL && store->direct)
+        {
+            int flags = fcntl(store->fd, F_GETFL);
+#ifdef O_DIRECT
+            flags &= ~O_DIRECT;
+#endif
+            if (fcntl(store->fd, F_SETFL, flags) == 0)
+            {
+                store->direct = 0;
+                continue;
+            }
+        }
+        if (store->errors++ == 0)
+            perror(writing ? "Image write" : "Image read");
+        return -1;
+    }
+}
+
+static size_t stampBytes(const struct BlockStore *store)
+{
+    return sizeof(struct BlockStamp) < (size_t)store->blockSize ? sizeof(struct BlockStamp) : (size_t)store->blockSize;
+}
+
+// Compare the stamps of the 'count' blocks read into the read buffer from
+// 'start' with what was last written there. Blocks never written by this
+// run are not checked.
+static void checkStamps(struct BlockStore *store, int start, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long long sequence = store->written[start + i];
+        struct BlockStamp stamp = {0, 0};
+        memcpy(&stamp, store->readBuffer + (size_t)i * store->blockSize, stampBytes(store));
+        if (sequence != 0 && (stamp.block != (unsigned long long)(start + i) || stamp.sequence != sequence))
+        {
+            if (store->mismatches++ == 0)
+                fprintf(stderr, "Image block %d holds block %llu of write %llu, expected write %llu\n", start + i,
+                        stamp.block, stamp.sequence, sequence);
+        }
+    }
+}
+
+// Read 'count' blocks from 'start', a chunk at a time, and check each
+// block's stamp. Returns -1 if any read failed.
+int blockStoreRead(struct BlockStore *store, int start, int count)
+{
+    int result = 0;
+    while (count > 0)
+    {
+        int chunk = count < store->chunkBlocks ? count : store->chunkBlocks;
+        if (transfer(store, start, chunk, 0, store->readBuffer) != 0)
+            result = -1;
+        else
+            checkStamps(store, start, chunk);
+        start += chunk;
+        count -= chunk;
+    }
+    return result;
+}
+
+// Write the payload to 'count' blocks from 'start', each stamped with its
+// block number. Returns -1 if any write failed.
+int blockStoreWrite(struct BlockStore *store, int start, int count)
+{
+    int result = 0;
+    while (count > 0)
+    {
+        int chunk = count < store->chunkBlocks ? count : store->chunkBlocks;
+        store->sequence++;
+        for (int i = 0; i < chunk; i++)
+        {
+            struct BlockStamp stamp = {(unsigned long long)(start + i), store->sequence};
+            memcpy(store->buffer + (size_t)i * store->blockSize, &stamp, stampBytes(store));
+            store->written[start + i] = store->sequence;
+        }
+        if (transfer(store, start, chunk, 1, store->buffer) != 0)
+            result = -1;
+        start += chunk;
+        count -= chunk;
+    }
+    return result;
+}
+
+// Move 'count' blocks from 'from' to 'to' a chunk at a time: each chunk is
+// read, checked, restamped with its new block number (its write sequence
+// stays) and written back out. Overlapping ranges are copied from the end
+// that is not overwritten first. Returns -1 if any read or write failed.
+int blockStoreCopy(struct BlockStore *store, int from, int to, int count)
+{
+    int result = 0;
+    int backward = to > from;
+    for (int done = 0; done < count;)
+    {
+        int chunk = count - done < store->chunkBlocks ? count - done : store->chunkBlocks;
+        int offset = backward ? count - done - chunk : done;
+        if (transfer(store, from + offset, chunk, 0, store->readBuffer) != 0)
+        {
+            result = -1;
+        }
+        else
+        {
+            checkStamps(store, from + offset, chunk);
+            for (int i = 0; i < chunk; i++)
+            {
+                unsigned char *block = store->readBuffer + (size_t)i * store->blockSize;
+                struct BlockStamp stamp = {0, 0};
+                memcpy(&stamp, block, stampBytes(store));
+                stamp.block = (unsigned long long)(to + offset + i);
+                memcpy(block, &stamp, stampBytes(store));
+                store->written[to + offset + i] = stamp.sequence;
+            }
+            if (transfer(store, to + offset, chunk, 1, store->readBuffer) != 0)
+                result = -1;
+        }
+        done += chunk;
+    }
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef BLOCK_STORE_H
+#define BLOCK_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes at the start of every block written: its block number and a
+// write sequence number, so an image can be checked by hand
+struct BlockStamp
+{
+    unsigned long long block;
+    unsigned long long sequence;
+};
+
+// Backing image for the simulated disk: block b is the blockSize bytes at
+// b * blockSize of a real file, read and written with pread and pwrite so
+// each layout's I/O pattern can be timed on real storage. The image is
+// opened with O_DIRECT where the file system supports it, so reads reach
+// the storage instead of the page cache. Moves copy the bytes they read,
+// and every block read back is checked against the stamp last written.
+struct BlockStore
+{
+    int fd;
+    int blockSize;
+    int blockCount;
+    int direct;                  // 1 while I/O bypasses the page cache
+    unsigned char *buffer;       // chunkBlocks blocks of payload, aligned for O_DIRECT
+    unsigned char *readBuffer;   // Where reads land, the same size
+    int chunkBlocks;             // Most blocks moved by one pread or pwrite
+    unsigned long long sequence; // Writes so far
+    unsigned long long *written; // Sequence each block was last written with, 0 if never
+    long long readBytes, writeBytes;
+    long long readCalls, writeCalls;
+    double readSeconds, writeSeconds; // Wall time spent in pread and pwrite
+    long long errors;
+    long long mismatches; // Blocks read back with a stamp other than the one written
+};
+
+int blockStoreOpen(struct BlockStore *store, const char *path, int blockCount, int blockSize);
+void blockStoreClose(struct BlockStore *store);
+int blockStoreRead(struct BlockStore *store, int start, int count);
+int blockStoreWrite(struct BlockStore *store, int start, int count);
+int blockStoreCopy(struct BlockStore *store, int from, int to, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
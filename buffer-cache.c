@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer-cache.h"
+
+static const char *policyNames[CACHE_POLICIES] = {"lru", "clock", "arc"};
+
+int cachePolicyKind(const char *name)
+{
+    for (int policy = 0; policy < CACHE_POLICIES; policy++)
+    {
+        if (strcmp(name, policyNames[policy]) == 0)
+            return policy;
+    }
+    return -1;
+}
+
+const char *cachePolicyName(int policy)
+{
+    return policy >= 0 && policy < CACHE_POLICIES ? policyNames[policy] : "unknown";
+}
+
+// Returns -1 if out of memory
+int bufferCacheInit(struct BufferCache *cache, int policy, int capacity)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->policy = policy;
+    cache->capacity = capacity;
+    cache->freeList = -1;
+    if (policy == CACHE_LRU)
+        return lruInit(&cache->lru, capacity);
+
+    int entryCount = policy == CACHE_ARC ? 2 * capacity : capacity;
+    unsigned int bucketCount = 1;
+    while (bucketCount < 2u * (unsigned int)entryCount)
+    {
+        bucketCount *= 2;
+    }
+    cache->entries = malloc(sizeof(struct CacheEntry) * (entryCount > 0 ? entryCount : 1));
+    cache->buckets = malloc(sizeof(int) * bucketCount);
+    if (cache->entries == NULL || cache->buckets == NULL)
+    {
+        bufferCacheDestroy(cache);
+        return -1;
+    }
+    for (unsigned int i = 0; i < bucketCount; i++)
+    {
+        cache->buckets[i] = -1;
+    }
+    cache->mask = bucketCount - 1;
+    for (int list = 0; list < 4; list++)
+    {
+        cache->head[list] = -1;
+        cache->tail[list] = -1;
+    }
+    return 0;
+}
+
+void bufferCacheDestroy(struct BufferCache *cache)
+{
+    if (cache->policy == CACHE_LRU)
+        lruDestroy(&cache->lru);
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->capacity = 0;
+}
+
+static unsigned int bucketOf(const struct BufferCache *cache, int key)
+{
+    return ((unsigned int)key * 2654435761u) & cache->mask;
+}
+
+static int findEntry(const struct BufferCache *cache, int key)
+{
+    for (int i = cache->buckets[bucketOf(cache, key)]; i != -1; i = cache->entries[i].hashNext)
+    {
+        if (cache->entries[i].key == key)
+            return i;
+    }
+    return -1;
+}
+
+static void hashInsert(struct BufferCache *cache, int i, int key)
+{
+    unsigned int bucket = bucketOf(cache, key);
+    cache->entries[i].key = key;
+    cache->entries[i].hashNext = cache->buckets[bucket];
+    cache->buckets[bucket] = i;
+}
+
+static void hashRemove(struct BufferCache *cache, int i)
+{
+    int *link = &cache->buckets[bucketOf(cache, cache->entries[i].key)];
+    while (*link != i)
+    {
+        link = &cache->entries[*link].hashNext;
+    }
+    *link = cache->entries[i].hashNext;
+}
+
+static int clockAccess(struct BufferCache *cache, int block)
+{
+    int i = findEntry(cache, block);
+    if (i != -1)
+    {
+        cache->entries[i].state = 1;
+        return 1;
+    }
+
+    if (cache->used < cache->capacity)
+    {
+        i = cache->used++;
+    }
+    else
+    {
+        // Sweep past referenced frames, clearing their bit, to the first
+        // frame not used since the hand last passed it
+        while (cache->entries[cache->hand].state)
+        {
+            cache->entries[cache->hand].state = 0;
+            cache->hand = (cache->hand + 1) % cache->capacity;
+        }
+        i = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+        hashRemove(cache, i);
+        cache->evictions++;
+    }
+    hashInsert(cache, i, block);
+    cache->entries[i].state = 0; // Set on its first hit, as in the page daemon
+    return 0;
+}
+
+static void listRemove(struct BufferCache *cache, int i)
+{
+    struct CacheEntry *entry = &cache->entries[i];
+    int list = entry->state;
+    if (entry->prev != -1)
+        cache->entries[entry->prev].next = entry->next;
+    else
+        cache->head[list] = entry->next;
+    if (entry->next != -1)
+        cache->entries[entry->next].prev = entry->prev;
+    else
+        cache->tail[list] = entry->prev;
+    cache->size[list]--;
+}
+
+static void listPushHead(struct BufferCache *cache, int i, int list)
+{
+    struct CacheEntry *entry = &cache->entries[i];
+    entry->state = (unsigned char)list;
+    entry->prev = -1;
+    entry->next = cache->head[list];
+    if (cache->head[list] != -1)
+        cache->entries[cache->head[list]].prev = i;
+    cache->head[list] = i;
+    if (cache->tail[list] == -1)
+        cache->tail[list] = i;
+    cache->size[list]++;
+}
+
+static void moveTo(struct BufferCache *cache, int i, int list)
+{
+    listRemove(cache, i);
+    listPushHead(cache, i, list);
+}
+
+// Forget the least recent ghost on 'list' and free its entry
+static void dropGhost(struct BufferCache *cache, int list)
+{
+    int i = cache->tail[list];
+    listRemove(cache, i);
+    hashRemove(cache, i);
+    cache->entries[i].next = cache->freeList;
+    cache->freeList = i;
+}
+
+// ARC's REPLACE: evict the least recent block of T1 or T2 to its ghost list
+static void arcReplace(struct BufferCache *cache, int inB2)
+{
+    int fromT1 = cache->size[ARC_T1] > 0 &&
+                 (cache->size[ARC_T1] > cache->target || (inB2 && cache->size[ARC_T1] == cache->target));
+    if (fromT1)
+        moveTo(cache, cache->tail[ARC_T1], ARC_B1);
+    else
+        moveTo(cache, cache->tail[ARC_T2], ARC_B2);
+    cache->evictions++;
+}
+
+static int arcAccess(struct BufferCache *cache, int block)
+{
+    int c = cache->capacity;
+    int i = findEntry(cache, block);
+    if (i != -1 && (cache->entries[i].state == ARC_T1 || cache->entries[i].state == ARC_T2))
+    {
+        moveTo(cache, i, ARC_T2);
+        return 1;
+    }
+    if (i != -1)
+    {
+        // A ghost hit: the list it was evicted from deserves more room
+        int inB1 = cache->entries[i].state == ARC_B1;
+        int b1 = cache->size[ARC_B1], b2 = cache->size[ARC_B2];
+        if (inB1)
+        {
+            int step = b2 > b1 ? b2 / b1 : 1;
+            cache->target = cache->target + step < c ? cache->target + step : c;
+        }
+        else
+        {
+            int step = b1 > b2 ? b1 / b2 : 1;
+            cache->target = cache->target - step > 0 ? cache->target - step : 0;
+        }
+        arcReplace(cache, !inB1);
+        moveTo(cache, i, ARC_T2);
+        return 0;
+    }
+
+    int t1 = cache->size[ARC_T1], b1 = cache->size[ARC_B1];
+    int total = t1 + cache->size[ARC_T2] + b1 + cache->size[ARC_B2];
+    if (t1 + b1 == c)
+    {
+        if (t1 < c)
+        {
+            dropGhost(cache, ARC_B1);
+            arcReplace(cache, 0);
+        }
+        else
+        {
+            // T1 fills the cache: its oldest block leaves without a ghost
+            int oldest = cache->tail[ARC_T1];
+            listRemove(cache, oldest);
+            hashRemove(cache, oldest);
+            cache->entries[oldest].next = cache->freeList;
+            cache->freeList = oldest;
+            cache->evictions++;
+        }
+    }
+    else if (total >= c)
+    {
+        if (total == 2 * c)
+            dropGhost(cache, ARC_B2);
+        arcReplace(cache, 0);
+    }
+
+    if (cache->freeList != -1)
+    {
+        i = cache->freeList;
+        cache->freeList = cache->entries[i].next;
+    }
+    else
+    {
+        i = cache->used++;
+    }
+    hashInsert(cache, i, block);
+    listPushHead(cache, i, ARC_T1);
+    return 0;
+}
+
+// Look 'block' up and bring it in if missing, evicting by the cache's
+// policy. Returns 1 on a hit, 0 on a miss.
+int bufferCacheAccess(struct BufferCache *cache, int block)
+{
+    if (cache->capacity == 0)
+    {
+        cache->misses++;
+        return 0;
+    }
+
+    int hit;
+    if (cache->policy == CACHE_LRU)
+    {
+        int full = cache->lru.count == cache->capacity;
+        hit = lruTouch(&cache->lru, block);
+        if (!hit && full)
+            cache->evictions++;
+    }
+    else if (cache->policy == CACHE_CLOCK)
+    {
+        hit = clockAccess(cache, block);
+    }
+    else
+    {
+        hit = arcAccess(cache, block);
+    }
+    if (hit)
+        cache->hits++;
+    else
+        cache->misses++;
+    return hit;
+}
+
+size_t bufferCacheBytes(const struct BufferCache *cache)
+{
+    if (cache->policy == CACHE_LRU)
+        return lruBytes(&cache->lru);
+    int entryCount = cache->policy == CACHE_ARC ? 2 * cache->capacity : cache->capacity;
+    return sizeof(struct CacheEntry) * entryCount + sizeof(int) * (cache->mask + 1);
+}
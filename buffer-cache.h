@@ -0,0 +1,67 @@
+#ifndef BUFFER_CACHE_H
+#define BUFFER_CACHE_H
+
+#include <stddef.h>
+
+#include "lru.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHE_LRU 0
+#define CACHE_CLOCK 1
+#define CACHE_ARC 2
+#define CACHE_POLICIES 3
+
+// ARC's four lists: recently and frequently used blocks in the cache, and
+// the ghost lists remembering blocks recently evicted from each
+#define ARC_T1 0
+#define ARC_T2 1
+#define ARC_B1 2
+#define ARC_B2 3
+
+// A block in the CLOCK ring or on an ARC list
+struct CacheEntry
+{
+    int key;
+    int prev, next; // ARC: list links, most recent at head
+    int hashNext;   // Next entry in the same bucket
+    unsigned char state; // CLOCK: referenced bit. ARC: ARC_* list
+};
+
+// Fixed number of cached disk blocks in front of the device, with one of
+// three replacement policies. LRU is the lru.c cache; CLOCK keeps a ring
+// of frames with a referenced bit swept by a hand; ARC (Megiddo and Modha)
+// splits the cache between recency and frequency lists and moves the split
+// by watching hits on recently evicted blocks.
+struct BufferCache
+{
+    int policy;
+    int capacity; // Blocks held
+    struct LruCache lru;
+    struct CacheEntry *entries; // CLOCK: capacity frames. ARC: 2 * capacity
+    int *buckets;
+    unsigned int mask; // Bucket count - 1, the count is a power of two
+    int used;     // Entries handed out so far
+    int freeList; // ARC: entries of dropped ghosts, linked through next
+    int hand;     // CLOCK
+    int head[4], tail[4], size[4]; // ARC lists
+    int target;   // ARC: size T1 is steered towards
+    long long hits;
+    long long misses;
+    long long evictions;
+};
+
+int cachePolicyKind(const char *name);
+const char *cachePolicyName(int policy);
+int bufferCacheInit(struct BufferCache *cache, int policy, int capacity);
+void bufferCacheDestroy(struct BufferCache *cache);
+int bufferCacheAccess(struct BufferCache *cache, int block);
+size_t bufferCacheBytes(const struct BufferCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
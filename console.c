@@ -0,0 +1,3 @@
+#include "console.h"
+
+int consoleQuiet = 0;
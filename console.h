@@ -0,0 +1,20 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set while replaying a workload so per-operation messages are skipped
+extern int consoleQuiet;
+
+// printf for messages from insert/delete/access routines
+#define consolePrintf(...) ((void)(consoleQuiet || printf(__VA_ARGS__)))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,300 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "block-store.h"
+#include "buffer-cache.h"
+#include "device.h"
+#include "readahead.h"
+
+// 7200 rpm disk with 150 MB/s media rate
+#define HDD_RPM 7200.0
+#define HDD_MIN_SEEK_MS 0.5
+#define HDD_MAX_SEEK_MS 15.0
+#define HDD_MB_PER_SECOND 150.0
+
+// SATA-class flash
+#define SSD_ACCESS_MS 0.08
+#define SSD_MB_PER_SECOND 500.0
+
+// Copying a cached block out of memory
+#define MEMORY_MB_PER_SECOND 10000.0
+
+struct Device device;
+
+static const char *deviceNames[DEVICE_KINDS] = {"hdd", "ssd"};
+
+int deviceKind(const char *name)
+{
+    for (int kind = 0; kind < DEVICE_KINDS; kind++)
+    {
+        if (strcmp(name, deviceNames[kind]) == 0)
+            return kind;
+    }
+    return -1;
+}
+
+const char *deviceName(int kind)
+{
+    return kind >= 0 && kind < DEVICE_KINDS ? deviceNames[kind] : "unknown";
+}
+
+// Set up the latency model, with a buffer cache of 'cacheBlocks' blocks
+// in front of it unless that is 0. Returns -1 if out of memory.
+int deviceInit(struct Device *device, int kind, int blockCount, int blockSize, int cachePolicy, int cacheBlocks)
+{
+    if (device->cache != NULL)
+    {
+        bufferCacheDestroy(device->cache);
+        free(device->cache);
+    }
+    if (device->store != NULL)
+    {
+        blockStoreClose(device->store);
+        free(device->store);
+    }
+    memset(device, 0, sizeof(*device));
+    device->kind = kind;
+    device->blockCount = blockCount;
+    device->blockSize = blockSize;
+    device->head = -1;
+
+    double megabytesPerSecond = kind == DEVICE_SSD ? SSD_MB_PER_SECOND : HDD_MB_PER_SECOND;
+    device->transferMs = blockSize / (megabytesPerSecond * 1e6) * 1000;
+    if (kind == DEVICE_SSD)
+    {
+        device->accessMs = SSD_ACCESS_MS;
+    }
+    else
+    {
+        device->minSeekMs = HDD_MIN_SEEK_MS;
+        device->maxSeekMs = HDD_MAX_SEEK_MS;
+        device->rotationMs = 60000.0 / HDD_RPM / 2;
+    }
+
+    device->hitMs = blockSize / (MEMORY_MB_PER_SECOND * 1e6) * 1000;
+    readaheadInit(&readahead, 0, 0); // Strategies that read ahead turn it on after this
+    if (cacheBlocks > 0)
+    {
+        device->cache = malloc(sizeof(struct BufferCache));
+        if (device->cache == NULL || bufferCacheInit(device->cache, cachePolicy, cacheBlocks) != 0)
+        {
+            free(device->cache);
+            device->cache = NULL;
+            printf("Not enough memory for a %d-block buffer cache\n", cacheBlocks);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Back the disk with the image file at 'path', none if it is NULL. Returns
+// -1 if the image cannot be used.
+int deviceAttachImage(struct Device *device, const char *path)
+{
+    if (path == NULL)
+        return 0;
+    device->store = malloc(sizeof(struct BlockStore));
+    if (device->store == NULL || blockStoreOpen(device->store, path, device->blockCount, device->blockSize) != 0)
+    {
+        free(device->store);
+        device->store = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void deviceSample(const struct Device *device, struct DeviceSample *sample)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->clockMs = device->clockMs;
+    sample->readRequests = device->readRequests;
+    sample->readMs = device->readMs;
+    if (device->cache != NULL)
+    {
+        sample->cacheHits = device->cache->hits;
+        sample->cacheMisses = device->cache->misses;
+        sample->cacheEvictions = device->cache->evictions;
+    }
+    sample->prefetched = device->prefetched;
+    sample->prefetchHits = device->prefetchHits;
+    sample->prefetchMs = device->prefetchMs;
+    sample->hiddenMs = device->hiddenMs;
+    if (device->store != NULL)
+    {
+        sample->imageReadBytes = device->store->readBytes;
+        sample->imageReadSeconds = device->store->readSeconds;
+        sample->imageWriteBytes = device->store->writeBytes;
+        sample->imageWriteSeconds = device->store->writeSeconds;
+    }
+}
+
+// Time to move the head 'distance' blocks. Short seeks are dominated by
+// settling, long ones grow with the square root of the distance.
+static double seekMs(const struct Device *device, int distance)
+{
+    if (distance == 0)
+        return 0;
+    double fraction = (double)distance / (device->blockCount > 1 ? device->blockCount - 1 : 1);
+    return device->minSeekMs + (device->maxSeekMs - device->minSeekMs) * sqrt(fraction);
+}
+
+// Positioning delay before touching 'block'; nothing when the transfer
+// streams on from the last block touched
+static double positionAt(struct Device *device, int block)
+{
+    if (block == device->head + 1 && device->head != -1)
+        return 0;
+
+    int distance = device->head == -1 ? block : abs(block - device->head);
+    device->seeks++;
+    device->seekDistance += distance;
+    if (device->kind == DEVICE_SSD)
+        return device->accessMs;
+    return seekMs(device, distance) + device->rotationMs;
+}
+
+// What transferRun does with the backing image
+#define IMAGE_NONE 0  // Nothing, the caller copies the blocks itself
+#define IMAGE_READ 1
+#define IMAGE_WRITE 2
+
+// Charge 'count' contiguous blocks starting at 'start' to the virtual clock,
+// and move them to or from the backing image if there is one
+static double transferRun(struct Device *device, int start, int count, int image)
+{
+    double cost = positionAt(device, start) + count * device->transferMs;
+    device->head = start + count - 1;
+    device->clockMs += cost;
+    if (device->store != NULL && image == IMAGE_WRITE)
+        blockStoreWrite(device->store, start, count);
+    else if (device->store != NULL && image == IMAGE_READ)
+        blockStoreRead(device->store, start, count);
+    return cost;
+}
+
+// A block found in the buffer cache costs a memory copy and leaves the
+// head where it was
+static double cacheHit(struct Device *device)
+{
+    device->clockMs += device->hitMs;
+    return device->hitMs;
+}
+
+// Charge one block read to the virtual clock. Returns its cost in ms.
+double deviceRead(struct Device *device, int block)
+{
+    double cost;
+    device->readRequests++;
+    if (device->cache != NULL && bufferCacheAccess(device->cache, block))
+    {
+        cost = cacheHit(device);
+    }
+    else
+    {
+        device->reads++;
+        cost = transferRun(device, block, 1, IMAGE_READ);
+    }
+    device->readMs += cost;
+    return cost;
+}
+
+// Charge reading 'count' contiguous blocks from 'start': one positioning
+// cost, then transfers only. With a buffer cache, cached blocks are copied
+// from memory and each stretch of missing blocks is read as a run. Returns
+// the cost in ms.
+static double readRun(struct Device *device, int start, int count, int image)
+{
+    if (count <= 0)
+        return 0;
+    device->readRequests += count;
+    double cost = 0;
+    if (device->cache == NULL)
+    {
+        device->reads += count;
+        cost = transferRun(device, start, count, image);
+    }
+    else
+    {
+        int missStart = -1;
+        for (int block = start; block <= start + count; block++)
+        {
+            int hit = block < start + count && bufferCacheAccess(device->cache, block);
+            if ((hit || block == start + count) && missStart != -1)
+            {
+                device->reads += block - missStart;
+                cost += transferRun(device, missStart, block - missStart, image);
+                missStart = -1;
+            }
+            if (hit)
+                cost += cacheHit(device);
+            else if (block < start + count && missStart == -1)
+                missStart = block;
+        }
+    }
+    device->readMs += cost;
+    return cost;
+}
+
+double deviceReadRun(struct Device *device, int start, int count)
+{
+    return readRun(device, start, count, IMAGE_READ);
+}
+
+// Charge prefetching 'count' contiguous blocks from 'start'. The reader did
+// not ask for them yet, so they are not read requests. Returns the cost in ms.
+double devicePrefetchRun(struct Device *device, int start, int count)
+{
+    if (count <= 0)
+        return 0;
+    device->reads += count;
+    device->prefetched += count;
+    double cost = transferRun(device, start, count, IMAGE_READ);
+    device->prefetchMs += cost;
+    return cost;
+}
+
+// Charge a read served from data prefetched earlier: a memory copy. The
+// reader did not wait for the 'hiddenMs' its prefetch took. Returns the
+// cost in ms.
+double deviceReadBuffered(struct Device *device, double hiddenMs)
+{
+    device->readRequests++;
+    device->prefetchHits++;
+    device->hiddenMs += hiddenMs;
+    double cost = cacheHit(device);
+    device->readMs += cost;
+    return cost;
+}
+
+// Write new file data to the backing image, if there is one. Only the image
+// sees these writes: the latency model charges reads and compaction moves.
+void deviceStoreRun(struct Device *device, int start, int count)
+{
+    if (device->store != NULL && count > 0)
+        blockStoreWrite(device->store, start, count);
+}
+
+// Copy 'count' blocks from 'from' to 'to' in the backing image, if there
+// is one, without charging the latency model
+void deviceStoreCopy(struct Device *device, int from, int to, int count)
+{
+    if (device->store != NULL && count > 0 && from != to)
+        blockStoreCopy(device->store, from, to, count);
+}
+
+// Charge moving 'count' blocks from 'from' to 'to' as a read of the old
+// blocks plus a write of the new ones, writes being modelled like reads of
+// the same blocks, and copy the bytes read to their new place in the image.
+// Returns the cost in ms.
+double deviceMoveRun(struct Device *device, int from, int to, int count)
+{
+    if (count <= 0)
+        return 0;
+    double cost = readRun(device, from, count, IMAGE_NONE);
+    device->writes += count;
+    cost += transferRun(device, to, count, IMAGE_NONE);
+    deviceStoreCopy(device, from, to, count);
+    return cost;
+}
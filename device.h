@@ -0,0 +1,83 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVICE_HDD 0
+#define DEVICE_SSD 1
+#define DEVICE_KINDS 2
+
+struct BlockStore;
+struct BufferCache;
+
+// Latency model of the simulated disk. I/O advances a virtual clock
+// instead of sleeping, so costs follow each file's real block layout.
+struct Device
+{
+    int kind;
+    int blockCount;
+    int blockSize;
+    double transferMs;   // Moving one block to or from the medium
+    double accessMs;     // SSD: fixed cost of a non-sequential request
+    double minSeekMs;    // HDD: track-to-track seek
+    double maxSeekMs;    // HDD: full-stroke seek
+    double rotationMs;   // HDD: average rotational latency (half a turn)
+    int head;            // Last block touched, -1 before the first access
+    double clockMs;      // Simulated time spent on reads and writes so far
+    long long reads;
+    long long writes;
+    long long seeks;     // Accesses that did not continue from the last block
+    long long seekDistance; // Blocks the head travelled on those seeks
+    struct BufferCache *cache; // Blocks read from memory instead, or NULL
+    double hitMs;        // Copying one cached block
+    long long readRequests; // Blocks asked for, whether cached or not
+    double readMs;       // Time spent on those requests
+    long long prefetched;   // Blocks read ahead of the reader
+    double prefetchMs;      // Time spent reading them
+    long long prefetchHits; // Read requests served from prefetched blocks
+    double hiddenMs;        // Prefetch time behind those requests, not waited for
+    struct BlockStore *store; // Image file holding the blocks' bytes, or NULL
+};
+
+// Device counters at the start of a measured phase
+struct DeviceSample
+{
+    double clockMs;
+    long long readRequests;
+    double readMs;
+    long long cacheHits;
+    long long cacheMisses;
+    long long cacheEvictions;
+    long long prefetched;
+    long long prefetchHits;
+    double prefetchMs;
+    double hiddenMs;
+    long long imageReadBytes;
+    double imageReadSeconds;
+    long long imageWriteBytes;
+    double imageWriteSeconds;
+};
+
+// The disk every simulator reads through
+extern struct Device device;
+
+int deviceKind(const char *name);
+const char *deviceName(int kind);
+int deviceInit(struct Device *device, int kind, int blockCount, int blockSize, int cachePolicy, int cacheBlocks);
+int deviceAttachImage(struct Device *device, const char *path);
+void deviceSample(const struct Device *device, struct DeviceSample *sample);
+double deviceRead(struct Device *device, int block);
+double deviceReadRun(struct Device *device, int start, int count);
+double devicePrefetchRun(struct Device *device, int start, int count);
+double deviceReadBuffered(struct Device *device, double hiddenMs);
+double deviceMoveRun(struct Device *device, int from, int to, int count);
+void deviceStoreRun(struct Device *device, int start, int count);
+void deviceStoreCopy(struct Device *device, int from, int to, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "directory.h"
+
+unsigned int directoryHash(const char *name)
+{
+    // 32-bit FNV-1a
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++)
+    {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Bucket holding 'name', or the empty bucket where it would go
+static unsigned int findBucket(const struct Directory *directory, const char *name, unsigned int hash)
+{
+    unsigned int bucket = hash & directory->mask;
+    while (directory->buckets[bucket].slot != -1)
+    {
+        const struct DirectoryEntry *entry = &directory->buckets[bucket];
+        if (entry->hash == hash && strcmp(entry->name, name) == 0)
+            break;
+        bucket = (bucket + 1) & directory->mask;
+    }
+    return bucket;
+}
+
+// A name index for up to 'slotCount' names whose slots the caller
+// allocates itself (directoryLink / directoryUnlink). Returns -1 if out of
+// memory.
+int directoryInitIndex(struct Directory *directory, int slotCount)
+{
+    unsigned int bucketCount = 16;
+    while (bucketCount < 2u * (unsigned int)slotCount) // Keep the load factor at or below 1/2
+        bucketCount <<= 1;
+
+    directory->freeSlots = NULL;
+    directory->freeTop = 0;
+    directory->buckets = malloc(sizeof(struct DirectoryEntry) * bucketCount);
+    if (directory->buckets == NULL)
+        return -1;
+
+    directory->mask = bucketCount - 1;
+    directory->count = 0;
+    for (unsigned int i = 0; i < bucketCount; i++)
+    {
+        directory->buckets[i].slot = -1;
+    }
+    return 0;
+}
+
+// A name index that also hands out the file-table slots. Returns -1 if out
+// of memory.
+int directoryInit(struct Directory *directory, int slotCount)
+{
+    if (directoryInitIndex(directory, slotCount) != 0)
+        return -1;
+    directory->freeSlots = malloc(sizeof(int) * slotCount);
+    if (directory->freeSlots == NULL)
+    {
+        directoryDestroy(directory);
+        return -1;
+    }
+
+    for (int i = 0; i < slotCount; i++)
+    {
+        directory->freeSlots[i] = slotCount - 1 - i;
+    }
+    directory->freeTop = slotCount;
+    return 0;
+}
+
+void directoryDestroy(struct Directory *directory)
+{
+    free(directory->buckets);
+    free(directory->freeSlots);
+    directory->buckets = NULL;
+    directory->freeSlots = NULL;
+}
+
+// File-table slot of 'name', or -1
+int directoryLookup(const struct Directory *directory, const char *name)
+{
+    unsigned int bucket = findBucket(directory, name, directoryHash(name));
+    return directory->buckets[bucket].slot;
+}
+
+// Slot the next directoryAdd will use, or -1 if the table is full
+int directoryNextSlot(const struct Directory *directory)
+{
+    return directory->freeTop > 0 ? directory->freeSlots[directory->freeTop - 1] : -1;
+}
+
+// Enter 'name', which must stay valid until the entry is removed, with a
+// slot the caller chose. Returns the slot, or -1 if the name is present.
+int directoryLink(struct Directory *directory, const char *name, int slot)
+{
+    unsigned int hash = directoryHash(name);
+    unsigned int bucket = findBucket(directory, name, hash);
+    if (directory->buckets[bucket].slot != -1)
+        return -1;
+
+    struct DirectoryEntry *entry = &directory->buckets[bucket];
+    entry->name = name;
+    entry->hash = hash;
+    entry->slot = slot;
+    directory->count++;
+    return slot;
+}
+
+// Claim the slot returned by directoryNextSlot for 'name', which must stay
+// valid until the entry is removed. Returns the slot, or -1 if the table is
+// full or the name is already present.
+int directoryAdd(struct Directory *directory, const char *name)
+{
+    if (directory->freeTop == 0 || directoryLink(directory, name, directory->freeSlots[directory->freeTop - 1]) == -1)
+        return -1;
+    return directory->freeSlots[--directory->freeTop];
+}
+
+// Drop 'name' without touching the free stack. Returns its slot, or -1.
+int directoryUnlink(struct Directory *directory, const char *name)
+{
+    unsigned int bucket = findBucket(directory, name, directoryHash(name));
+    int slot = directory->buckets[bucket].slot;
+    if (slot == -1)
+        return -1;
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole so lookups never need tombstones
+    unsigned int hole = bucket;
+    unsigned int next = (hole + 1) & directory->mask;
+    while (directory->buckets[next].slot != -1)
+    {
+        unsigned int home = directory->buckets[next].hash & directory->mask;
+        if (((next - home) & directory->mask) >= ((next - hole) & directory->mask))
+        {
+            directory->buckets[hole] = directory->buckets[next];
+            hole = next;
+        }
+        next = (next + 1) & directory->mask;
+    }
+    directory->buckets[hole].slot = -1;
+    directory->count--;
+    return slot;
+}
+
+// Drop 'name' and return its slot to the free stack. Returns the slot, or -1.
+int directoryRemove(struct Directory *directory, const char *name)
+{
+    int slot = directoryUnlink(directory, name);
+    if (slot != -1)
+        directory->freeSlots[directory->freeTop++] = slot;
+    return slot;
+}
+
+// Memory held by the bucket array and the free-slot stack
+size_t directoryBytes(const struct Directory *directory)
+{
+    int slotCount = directory->freeSlots != NULL ? directory->count + directory->freeTop : 0;
+    return sizeof(struct DirectoryEntry) * (directory->mask + 1) + sizeof(int) * slotCount;
+}
@@ -0,0 +1,36 @@
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <stddef.h>
+
+// Open-addressing (linear probing) name index over a file table, plus a
+// stack of unused file-table slots unless the caller allocates slots itself.
+struct DirectoryEntry
+{
+    const char *name;  // Points at the file table's copy of the name
+    unsigned int hash; // Cached so probes compare hashes before names
+    int slot;          // File-table slot, -1 for an empty bucket
+};
+
+struct Directory
+{
+    struct DirectoryEntry *buckets;
+    unsigned int mask; // Bucket count - 1, the count is a power of two
+    int count;
+    int *freeSlots;    // Unused file-table slots, lowest on top initially, or NULL
+    int freeTop;
+};
+
+unsigned int directoryHash(const char *name);
+int directoryInit(struct Directory *directory, int slotCount);
+int directoryInitIndex(struct Directory *directory, int slotCount);
+void directoryDestroy(struct Directory *directory);
+int directoryLookup(const struct Directory *directory, const char *name);
+int directoryNextSlot(const struct Directory *directory);
+int directoryAdd(struct Directory *directory, const char *name);
+int directoryRemove(struct Directory *directory, const char *name);
+int directoryLink(struct Directory *directory, const char *name, int slot);
+int directoryUnlink(struct Directory *directory, const char *name);
+size_t directoryBytes(const struct Directory *directory);
+
+#endif
@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "extent-tree.h"
+
+size_t extentTreeMemory = 0;
+
+static size_t nodeBytes(const struct ExtentNode *node)
+{
+    size_t entry = node->height == 0 ? sizeof(struct Extent) : sizeof(int) + sizeof(struct ExtentNode *);
+    return sizeof(struct ExtentNode) + entry * node->capacity;
+}
+
+// Give a node empty entry arrays for its height. Returns -1 if out of memory.
+static int allocEntries(struct ExtentNode *node)
+{
+    node->count = 0;
+    node->extents = NULL;
+    node->keys = NULL;
+    node->children = NULL;
+    if (node->height == 0)
+    {
+        node->extents = malloc(sizeof(struct Extent) * node->capacity);
+        if (node->extents == NULL)
+            return -1;
+    }
+    else
+    {
+        node->keys = malloc(sizeof(int) * node->capacity);
+        node->children = malloc(sizeof(struct ExtentNode *) * node->capacity);
+        if (node->keys == NULL || node->children == NULL)
+            return -1;
+    }
+    extentTreeMemory += nodeBytes(node);
+    return 0;
+}
+
+static void freeEntries(struct ExtentNode *node)
+{
+    extentTreeMemory -= nodeBytes(node);
+    free(node->extents);
+    free(node->keys);
+    free(node->children);
+}
+
+static struct ExtentNode *newNode(int height, int capacity, int block)
+{
+    struct ExtentNode *node = malloc(sizeof(struct ExtentNode));
+    if (node == NULL)
+        return NULL;
+    node->block = block;
+    node->height = height;
+    node->capacity = capacity;
+    if (allocEntries(node) != 0)
+    {
+        free(node);
+        return NULL;
+    }
+    return node;
+}
+
+// Entries in a block-sized node: the block minus its header, like ext4
+int extentTreeInit(struct ExtentTree *tree, int blockSize)
+{
+    tree->nodeCapacity = (blockSize - EXTENT_ENTRY_BYTES) / EXTENT_ENTRY_BYTES;
+    tree->extentCount = 0;
+    tree->nodeBlocks = 0;
+    tree->root = newNode(0, EXTENT_INLINE, -1);
+    return tree->root != NULL ? 0 : -1;
+}
+
+static void destroyNode(struct ExtentNode *node, void (*releaseBlock)(int))
+{
+    for (int i = 0; node->height > 0 && i < node->count; i++)
+    {
+        destroyNode(node->children[i], releaseBlock);
+    }
+    if (node->block != -1)
+        releaseBlock(node->block);
+    freeEntries(node);
+    free(node);
+}
+
+// Free every node, handing the disk blocks of all but the root to releaseBlock
+void extentTreeDestroy(struct ExtentTree *tree, void (*releaseBlock)(int))
+{
+    destroyNode(tree->root, releaseBlock);
+    tree->root = NULL;
+    tree->extentCount = 0;
+    tree->nodeBlocks = 0;
+}
+
+static const struct Extent *lastExtent(const struct ExtentTree *tree)
+{
+    const struct ExtentNode *node = tree->root;
+    while (node->height > 0)
+    {
+        node = node->children[node->count - 1];
+    }
+    return node->count > 0 ? &node->extents[node->count - 1] : NULL;
+}
+
+static int canMerge(const struct Extent *last, int logical, int physical, int length)
+{
+    return last != NULL && last->logical + last->length == logical &&
+           last->physical + last->length == physical && last->length + length <= EXTENT_MAX_LENGTH;
+}
+
+// Full nodes at the bottom of the rightmost path, counting up from the leaf
+static int fullTail(const struct ExtentNode *node, int *reachedTop)
+{
+    int below = node->height > 0 ? fullTail(node->children[node->count - 1], reachedTop) : 0;
+    if (below < node->height || node->count < node->capacity)
+    {
+        *reachedTop = 0;
+        return below;
+    }
+    *reachedTop = 1;
+    return below + 1;
+}
+
+// Disk blocks that appending the extent (logical, physical, length) would
+// add to the tree. Every full node on the rightmost path splits, and a full
+// root moves down into a new block.
+int extentTreeBlocksNeeded(const struct ExtentTree *tree, int logical, int physical, int length)
+{
+    if (canMerge(lastExtent(tree), logical, physical, length))
+        return 0;
+    int reachedTop;
+    int needed = fullTail(tree->root, &reachedTop);
+    if (reachedTop && tree->root->count >= tree->nodeCapacity)
+        needed++; // Tiny blocks: the root's entries fill the new block, which splits too
+    return needed;
+}
+
+// Most disk blocks appending 'extents' more extents can add to the tree.
+// Every node on the rightmost path is taken to be full, so each level gains
+// a node per nodeCapacity entries arriving from below, and an overflowing
+// root moves down into new blocks until the entries above fit in it.
+int extentTreeBlocksBound(const struct ExtentTree *tree, int extents)
+{
+    int capacity = tree->nodeCapacity;
+    int blocks = 0, entries = extents; // New entries arriving at the level
+    for (int level = 0; level < tree->root->height; level++)
+    {
+        entries = (entries + capacity - 1) / capacity;
+        blocks += entries;
+    }
+    int rootCount = tree->root->count;
+    while (entries > 0 && rootCount + entries > EXTENT_INLINE)
+    {
+        entries = (rootCount + entries + capacity - 1) / capacity;
+        blocks += entries;
+        rootCount = 0;
+    }
+    return blocks;
+}
+
+// Add 'extent' under 'node'. Returns the new right sibling if the node was
+// full and had to split, NULL if it had room, or 'node' itself if out of
+// memory.
+static struct ExtentNode *appendAt(struct ExtentTree *tree, struct ExtentNode *node, const struct Extent *extent,
+                                   int (*takeBlock)(void))
+{
+    struct ExtentNode *added = NULL;
+    if (node->height > 0)
+    {
+        struct ExtentNode *child = node->children[node->count - 1];
+        added = appendAt(tree, child, extent, takeBlock);
+        if (added == NULL || added == child)
+            return added == child ? node : NULL;
+    }
+
+    struct ExtentNode *target = node;
+    if (node->count == node->capacity)
+    {
+        target = newNode(node->height, tree->nodeCapacity, takeBlock());
+        if (target == NULL)
+            return node;
+        tree->nodeBlocks++;
+    }
+    if (node->height == 0)
+    {
+        target->extents[target->count++] = *extent;
+    }
+    else
+    {
+        target->keys[target->count] = extent->logical;
+        target->children[target->count++] = added;
+    }
+    return target != node ? target : NULL;
+}
+
+// Append a run of blocks at the end of the file, extending the last extent
+// when the run continues it on disk. The caller makes sure takeBlock can
+// supply extentTreeBlocksNeeded blocks. Returns -1 if out of memory.
+int extentTreeAppend(struct ExtentTree *tree, int logical, int physical, int length, int (*takeBlock)(void))
+{
+    struct Extent *last = (struct Extent *)lastExtent(tree);
+    if (canMerge(last, logical, physical, length))
+    {
+        last->length += length;
+        return 0;
+    }
+
+    struct ExtentNode *root = tree->root;
+    int reachedTop;
+    fullTail(root, &reachedTop);
+    if (reachedTop)
+    {
+        // The root's entries move into a new block, the root points to it
+        struct ExtentNode *down = newNode(root->height, tree->nodeCapacity, takeBlock());
+        if (down == NULL)
+            return -1;
+        tree->nodeBlocks++;
+        down->count = root->count;
+        if (root->height == 0)
+        {
+            memcpy(down->extents, root->extents, sizeof(struct Extent) * root->count);
+        }
+        else
+        {
+            memcpy(down->keys, root->keys, sizeof(int) * root->count);
+            memcpy(down->children, root->children, sizeof(struct ExtentNode *) * root->count);
+        }
+        freeEntries(root);
+        root->height++;
+        if (allocEntries(root) != 0)
+            return -1;
+        root->keys[0] = down->height == 0 ? down->extents[0].logical : down->keys[0];
+        root->children[0] = down;
+        root->count = 1;
+    }
+
+    struct Extent extent = {logical, physical, length};
+    if (appendAt(tree, root, &extent, takeBlock) != NULL)
+        return -1;
+    tree->extentCount++;
+    return 0;
+}
+
+// Disk block holding file block 'logical', or -1 if it is not mapped.
+// Each node below the root is passed to visitNode as the lookup reads it;
+// every node is searched by bisection.
+int extentTreeLookup(const struct ExtentTree *tree, int logical, void (*visitNode)(int))
+{
+    const struct ExtentNode *node = tree->root;
+    while (1)
+    {
+        if (node->block != -1)
+            visitNode(node->block);
+
+        // Last entry starting at or before 'logical'
+        int low = 0, high = node->count - 1, found = -1;
+        while (low <= high)
+        {
+            int middle = (low + high) / 2;
+            int start = node->height == 0 ? node->extents[middle].logical : node->keys[middle];
+            if (start <= logical)
+            {
+                found = middle;
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle - 1;
+            }
+        }
+        if (found == -1)
+            return -1;
+        if (node->height > 0)
+        {
+            node = node->children[found];
+            continue;
+        }
+        const struct Extent *extent = &node->extents[found];
+        return logical < extent->logical + extent->length ? extent->physical + logical - extent->logical : -1;
+    }
+}
+
+static void walkNode(const struct ExtentNode *node, void (*visit)(const struct Extent *))
+{
+    for (int i = 0; i < node->count; i++)
+    {
+        if (node->height == 0)
+            visit(&node->extents[i]);
+        else
+            walkNode(node->children[i], visit);
+    }
+}
+
+// Visit every extent in file order
+void extentTreeWalk(const struct ExtentTree *tree, void (*visit)(const struct Extent *))
+{
+    walkNode(tree->root, visit);
+}
@@ -0,0 +1,53 @@
+#ifndef EXTENT_TREE_H
+#define EXTENT_TREE_H
+
+#include <stddef.h>
+
+#define EXTENT_INLINE 4         // Entries that fit in the inode, as in ext4's i_block
+#define EXTENT_MAX_LENGTH 32768 // Longest extent, ext4's limit for written extents
+#define EXTENT_ENTRY_BYTES 12   // On-disk size of an extent, an index entry or a node header
+
+// A run of 'length' file blocks starting at file block 'logical', stored on
+// disk blocks physical .. physical + length - 1
+struct Extent
+{
+    int logical;
+    int physical;
+    int length;
+};
+
+// A tree node. The root lives in the inode and holds EXTENT_INLINE entries;
+// every other node occupies a disk block.
+struct ExtentNode
+{
+    int block;    // Disk block holding the node, -1 for the root
+    int height;   // 0 for a leaf of extents
+    int count;
+    int capacity;
+    struct Extent *extents;       // Leaf: extents in file order
+    int *keys;                    // Index: first file block under each child
+    struct ExtentNode **children; // Index
+};
+
+// ext4-style extent tree. Files only grow at the end, so extents are always
+// appended on the rightmost path; a full root moves down into a new block
+// and the tree gains a level.
+struct ExtentTree
+{
+    struct ExtentNode *root;
+    int nodeCapacity; // Entries in a block-sized node
+    int extentCount;
+    int nodeBlocks;   // Disk blocks used by nodes below the root
+};
+
+extern size_t extentTreeMemory; // Bytes held by all extent tree nodes
+
+int extentTreeInit(struct ExtentTree *tree, int blockSize);
+void extentTreeDestroy(struct ExtentTree *tree, void (*releaseBlock)(int));
+int extentTreeBlocksNeeded(const struct ExtentTree *tree, int logical, int physical, int length);
+int extentTreeBlocksBound(const struct ExtentTree *tree, int extents);
+int extentTreeAppend(struct ExtentTree *tree, int logical, int physical, int length, int (*takeBlock)(void));
+int extentTreeLookup(const struct ExtentTree *tree, int logical, void (*visitNode)(int));
+void extentTreeWalk(const struct ExtentTree *tree, void (*visit)(const struct Extent *));
+
+#endif
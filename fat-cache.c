@@ -0,0 +1,84 @@
+#include <stddef.h>
+
+#include "fat-cache.h"
+
+long long fatCacheHits = 0;
+long long fatCacheMisses = 0;
+
+static unsigned int useClock = 0;
+
+void fatCacheClear(struct FatCache *cache)
+{
+    cache->count = 0;
+}
+
+// Find the cached position closest to file block 'target' without passing
+// it. On a hit 'target' itself is cached and *fileBlock/*diskBlock are set
+// to it; returns 1. On a miss they are set to the furthest known block at or
+// before the target, or left alone if nothing useful is cached; returns 0.
+int fatCacheLookup(struct FatCache *cache, int target, int *fileBlock, int *diskBlock)
+{
+    struct FatCacheEntry *best = NULL;
+    for (int i = 0; i < cache->count; i++)
+    {
+        struct FatCacheEntry *entry = &cache->entries[i];
+        if (entry->fileBlock <= target && (best == NULL || entry->fileBlock > best->fileBlock))
+            best = entry;
+    }
+    if (best == NULL)
+    {
+        fatCacheMisses++;
+        return 0;
+    }
+
+    best->lastUse = ++useClock;
+    int reach = target - best->fileBlock;
+    if (reach > best->contiguous)
+    {
+        reach = best->contiguous;
+    }
+    *fileBlock = best->fileBlock + reach;
+    *diskBlock = best->diskBlock + reach;
+    if (*fileBlock == target)
+    {
+        fatCacheHits++;
+        return 1;
+    }
+    fatCacheMisses++;
+    return 0;
+}
+
+// Remember a run, growing an entry for the same run or replacing the least
+// recently used one when the cache is full
+void fatCacheAdd(struct FatCache *cache, int fileBlock, int diskBlock, int contiguous)
+{
+    struct FatCacheEntry *slot = NULL;
+    for (int i = 0; i < cache->count; i++)
+    {
+        if (cache->entries[i].fileBlock == fileBlock)
+        {
+            slot = &cache->entries[i];
+            if (slot->contiguous > contiguous)
+                contiguous = slot->contiguous;
+            break;
+        }
+    }
+    if (slot == NULL && cache->count < FAT_CACHE_ENTRIES)
+    {
+        slot = &cache->entries[cache->count++];
+    }
+    if (slot == NULL)
+    {
+        slot = &cache->entries[0];
+        for (int i = 1; i < cache->count; i++)
+        {
+            if (cache->entries[i].lastUse < slot->lastUse)
+                slot = &cache->entries[i];
+        }
+    }
+
+    slot->fileBlock = fileBlock;
+    slot->diskBlock = diskBlock;
+    slot->contiguous = contiguous;
+    slot->lastUse = ++useClock;
+}
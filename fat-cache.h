@@ -0,0 +1,31 @@
+#ifndef FAT_CACHE_H
+#define FAT_CACHE_H
+
+#define FAT_CACHE_ENTRIES 8
+
+// A run of a file: blocks fileBlock .. fileBlock + contiguous sit on disk
+// blocks diskBlock .. diskBlock + contiguous
+struct FatCacheEntry
+{
+    int fileBlock;
+    int diskBlock;
+    int contiguous;
+    unsigned int lastUse;
+};
+
+// Per-file cache of FAT chain positions, in the spirit of Linux's fat_cache:
+// a few recently used runs, evicted least recently used first
+struct FatCache
+{
+    struct FatCacheEntry entries[FAT_CACHE_ENTRIES];
+    int count;
+};
+
+extern long long fatCacheHits;
+extern long long fatCacheMisses;
+
+void fatCacheClear(struct FatCache *cache);
+int fatCacheLookup(struct FatCache *cache, int target, int *fileBlock, int *diskBlock);
+void fatCacheAdd(struct FatCache *cache, int fileBlock, int diskBlock, int contiguous);
+
+#endif
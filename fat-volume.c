@@ -0,0 +1,184 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fat-volume.h"
+
+#define IMAGE_MAGIC "FASFAT1"
+#define SECTOR_SIZE 512
+
+// Cluster count limits from the FAT specification
+#define FAT12_MAX_CLUSTERS 4084
+#define FAT16_MAX_CLUSTERS 65524
+#define FAT32_MAX_CLUSTERS 0x0FFFFFF5
+
+// FAT width an image of 'blockCount' clusters is formatted with
+int fatBitsFor(int blockCount)
+{
+    if (blockCount <= FAT12_MAX_CLUSTERS)
+        return 12;
+    if (blockCount <= FAT16_MAX_CLUSTERS)
+        return 16;
+    return 32;
+}
+
+static size_t packedFatBytes(int fatBits, int blockCount)
+{
+    size_t entries = (size_t)blockCount + 2;
+    return (entries * fatBits + 7) / 8 + 1; // One spare byte for the last FAT12 pair
+}
+
+static uint64_t roundToSector(uint64_t offset)
+{
+    return (offset + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+}
+
+int fatVolumeCreateMemory(struct FatVolume *volume, int blockCount)
+{
+    memset(volume, 0, sizeof(*volume));
+    volume->blockCount = blockCount;
+    volume->table = malloc(sizeof(int) * blockCount);
+    if (volume->table == NULL)
+        return -1;
+
+    for (int i = 0; i < blockCount; i++)
+    {
+        volume->table[i] = FAT_FREE;
+    }
+    volume->memoryInfo.freeCount = blockCount;
+    volume->memoryInfo.nextFree = 0;
+    volume->info = &volume->memoryInfo;
+    return 0;
+}
+
+static void pointIntoMap(struct FatVolume *volume)
+{
+    volume->header = volume->map;
+    volume->fatBits = volume->header->fatBits;
+    volume->blockCount = volume->header->blockCount;
+    volume->directory = (struct FatImageEntry *)((char *)volume->map + volume->header->directoryOffset);
+    volume->entries = (unsigned char *)volume->map + volume->header->fatOffset;
+    volume->info = &volume->header->info;
+}
+
+static int checkHeader(const struct FatImageHeader *header, size_t fileLength)
+{
+    if (fileLength < sizeof(*header) || memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0)
+        return -1;
+    if (header->fatBits != 12 && header->fatBits != 16 && header->fatBits != 32)
+        return -1;
+    if (header->blockCount == 0 || header->blockCount > FAT32_MAX_CLUSTERS || header->maxFiles == 0)
+        return -1;
+    uint64_t directoryEnd = header->directoryOffset + (uint64_t)header->maxFiles * sizeof(struct FatImageEntry);
+    if (directoryEnd > header->fatOffset ||
+        header->fatOffset + packedFatBytes(header->fatBits, header->blockCount) > header->imageLength ||
+        header->imageLength > fileLength)
+        return -1;
+    return 0;
+}
+
+// Open the image at 'path', or format a new one with the given geometry if
+// it does not exist. Only the header is read: the FAT and directory are used
+// in place through the mapping, so opening costs the same at any size.
+// Returns -1 with a message on stderr if the image is unusable.
+int fatVolumeOpenImage(struct FatVolume *volume, const char *path, int blockCount, int blockSize, int maxFiles)
+{
+    memset(volume, 0, sizeof(*volume));
+    int created = 0;
+    int fd = open(path, O_RDWR);
+    if (fd == -1)
+    {
+        if (blockCount > FAT32_MAX_CLUSTERS)
+        {
+            fprintf(stderr, "%s: a FAT32 volume holds at most %d clusters\n", path, FAT32_MAX_CLUSTERS);
+            return -1;
+        }
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        created = 1;
+    }
+    if (fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+
+    struct stat status;
+    if (created)
+    {
+        struct FatImageHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+        header.fatBits = fatBitsFor(blockCount);
+        header.blockCount = blockCount;
+        header.blockSize = blockSize;
+        header.maxFiles = maxFiles;
+        header.info.freeCount = blockCount;
+        header.info.nextFree = 0;
+        header.directoryOffset = SECTOR_SIZE;
+        header.fatOffset = roundToSector(header.directoryOffset + (uint64_t)maxFiles * sizeof(struct FatImageEntry));
+        header.imageLength = roundToSector(header.fatOffset + packedFatBytes(header.fatBits, blockCount));
+
+        // The file starts sparse and zero-filled: every entry reads as free
+        if (ftruncate(fd, header.imageLength) == -1 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+    }
+    if (fstat(fd, &status) == -1)
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    volume->mapLength = status.st_size;
+    volume->map = mmap(NULL, volume->mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (volume->map == MAP_FAILED)
+    {
+        perror(path);
+        volume->map = NULL;
+        return -1;
+    }
+    if (checkHeader(volume->map, volume->mapLength) != 0)
+    {
+        fprintf(stderr, "%s: not a FAT volume image\n", path);
+        fatVolumeClose(volume);
+        return -1;
+    }
+
+    pointIntoMap(volume);
+    if (created)
+    {
+        // Reserved clusters 0 and 1: media descriptor and end-of-chain
+        fatRawSet(volume, 0, (fatRawMask(volume->fatBits) & ~0xFFu) | 0xF8);
+        fatRawSet(volume, 1, fatRawMask(volume->fatBits));
+    }
+    return 0;
+}
+
+void fatVolumeClose(struct FatVolume *volume)
+{
+    if (volume->map != NULL)
+    {
+        msync(volume->map, volume->mapLength, MS_SYNC);
+        munmap(volume->map, volume->mapLength);
+        volume->map = NULL;
+    }
+    free(volume->table);
+    volume->table = NULL;
+}
+
+// Memory taken by the table in its own encoding
+size_t fatVolumeBytes(const struct FatVolume *volume)
+{
+    if (volume->fatBits == 0)
+        return sizeof(int) * (size_t)volume->blockCount;
+    return packedFatBytes(volume->fatBits, volume->blockCount);
+}
@@ -0,0 +1,149 @@
+#ifndef FAT_VOLUME_H
+#define FAT_VOLUME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Values fatGet returns besides a next block number
+#define FAT_EOF -1
+#define FAT_FREE -2
+
+#define FAT_NAME_MAX 64
+
+// Free-space summary kept next to the FAT, as in FAT32's FSInfo sector
+struct FatFsInfo
+{
+    int32_t freeCount; // Free clusters
+    int32_t nextFree;  // Where the next free-cluster search starts
+};
+
+// One file as stored in an image's directory; an empty name marks a free entry
+struct FatImageEntry
+{
+    char name[FAT_NAME_MAX];
+    int32_t start;
+    int32_t end;
+    int32_t blocks;
+};
+
+// First sector of an image: geometry, FSInfo and where the regions start
+struct FatImageHeader
+{
+    char magic[8];
+    uint32_t fatBits; // 12, 16 or 32
+    uint32_t blockCount;
+    uint32_t blockSize;
+    uint32_t maxFiles;
+    struct FatFsInfo info;
+    uint64_t directoryOffset;
+    uint64_t fatOffset;
+    uint64_t imageLength;
+};
+
+// The allocation table behind linked-fat: either a plain int per block in
+// memory, or FAT12/16/32 entries packed in a memory-mapped image file and
+// read and written in place. Block b is cluster b + 2, as clusters 0 and 1
+// are reserved.
+struct FatVolume
+{
+    int fatBits;            // 0 for the in-memory table, else 12, 16 or 32
+    int blockCount;
+    int *table;             // In-memory table (-1=EOF, -2=free, otherwise next block)
+    unsigned char *entries; // Packed FAT inside the mapping
+    struct FatImageHeader *header;
+    struct FatImageEntry *directory; // maxFiles entries inside the mapping
+    struct FatFsInfo memoryInfo;
+    struct FatFsInfo *info; // memoryInfo, or the header's copy on an image
+    void *map;
+    size_t mapLength;
+};
+
+int fatBitsFor(int blockCount);
+int fatVolumeCreateMemory(struct FatVolume *volume, int blockCount);
+int fatVolumeOpenImage(struct FatVolume *volume, const char *path, int blockCount, int blockSize, int maxFiles);
+void fatVolumeClose(struct FatVolume *volume);
+size_t fatVolumeBytes(const struct FatVolume *volume);
+
+// Largest raw value of a packed entry; end-of-chain markers are the top 8
+static inline unsigned int fatRawMask(int fatBits)
+{
+    return fatBits == 32 ? 0x0FFFFFFFu : (1u << fatBits) - 1;
+}
+
+static inline unsigned int fatRawGet(const struct FatVolume *volume, unsigned int cluster)
+{
+    const unsigned char *entry;
+    switch (volume->fatBits)
+    {
+    case 12:
+        entry = volume->entries + cluster + cluster / 2; // 1.5 bytes per entry
+        return cluster & 1 ? (entry[0] | entry[1] << 8) >> 4 : (entry[0] | entry[1] << 8) & 0xFFF;
+    case 16:
+        entry = volume->entries + (size_t)cluster * 2;
+        return entry[0] | entry[1] << 8;
+    default:
+        entry = volume->entries + (size_t)cluster * 4;
+        return (entry[0] | entry[1] << 8 | entry[2] << 16 | (unsigned int)entry[3] << 24) & 0x0FFFFFFF;
+    }
+}
+
+static inline void fatRawSet(struct FatVolume *volume, unsigned int cluster, unsigned int value)
+{
+    unsigned char *entry;
+    switch (volume->fatBits)
+    {
+    case 12:
+        entry = volume->entries + cluster + cluster / 2;
+        if (cluster & 1)
+        {
+            entry[0] = (entry[0] & 0x0F) | (value << 4 & 0xF0);
+            entry[1] = value >> 4;
+        }
+        else
+        {
+            entry[0] = value;
+            entry[1] = (entry[1] & 0xF0) | (value >> 8 & 0x0F);
+        }
+        break;
+    case 16:
+        entry = volume->entries + (size_t)cluster * 2;
+        entry[0] = value;
+        entry[1] = value >> 8;
+        break;
+    default:
+        entry = volume->entries + (size_t)cluster * 4;
+        entry[0] = value;
+        entry[1] = value >> 8;
+        entry[2] = value >> 16;
+        entry[3] = (entry[3] & 0xF0) | (value >> 24 & 0x0F); // Top 4 bits are reserved
+        break;
+    }
+}
+
+// Next block after 'block', FAT_EOF or FAT_FREE
+static inline int fatGet(const struct FatVolume *volume, int block)
+{
+    if (volume->fatBits == 0)
+        return volume->table[block];
+
+    unsigned int raw = fatRawGet(volume, block + 2);
+    if (raw == 0)
+        return FAT_FREE;
+    if (raw >= fatRawMask(volume->fatBits) - 7)
+        return FAT_EOF;
+    return (int)raw - 2;
+}
+
+static inline void fatSet(struct FatVolume *volume, int block, int next)
+{
+    if (volume->fatBits == 0)
+    {
+        volume->table[block] = next;
+        return;
+    }
+
+    unsigned int raw = next == FAT_FREE ? 0 : next == FAT_EOF ? fatRawMask(volume->fatBits) : (unsigned int)next + 2;
+    fatRawSet(volume, block + 2, raw);
+}
+
+#endif
@@ -0,0 +1,407 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "free-extents.h"
+#include "metrics.h"
+
+#define BY_START 0
+#define BY_LENGTH 1
+
+static unsigned int nextPriority(struct FreeExtentIndex *index)
+{
+    // xorshift32, good enough to keep both treaps balanced
+    unsigned int x = index->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    index->seed = x;
+    return x;
+}
+
+static int compareExtents(int tree, const struct FreeExtent *a, const struct FreeExtent *b)
+{
+    if (tree == BY_LENGTH && a->length != b->length)
+    {
+        return a->length < b->length ? -1 : 1;
+    }
+    if (a->start != b->start)
+    {
+        return a->start < b->start ? -1 : 1;
+    }
+    return 0;
+}
+
+static void update(int tree, struct FreeExtent *node)
+{
+    if (tree != BY_START)
+    {
+        return;
+    }
+    node->maxLength = node->length;
+    for (int side = 0; side < 2; side++)
+    {
+        struct FreeExtent *child = node->child[BY_START][side];
+        if (child != NULL && child->maxLength > node->maxLength)
+        {
+            node->maxLength = child->maxLength;
+        }
+    }
+}
+
+// Split root into nodes ordered before key (left) and the rest (right)
+static void split(int tree, struct FreeExtent *root, const struct FreeExtent *key,
+                  struct FreeExtent **left, struct FreeExtent **right)
+{
+    if (root == NULL)
+    {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+    if (compareExtents(tree, root, key) < 0)
+    {
+        split(tree, root->child[tree][1], key, &root->child[tree][1], right);
+        *left = root;
+    }
+    else
+    {
+        split(tree, root->child[tree][0], key, left, &root->child[tree][0]);
+        *right = root;
+    }
+    update(tree, root);
+}
+
+static struct FreeExtent *merge(int tree, struct FreeExtent *left, struct FreeExtent *right)
+{
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+
+    if (left->priority > right->priority)
+    {
+        left->child[tree][1] = merge(tree, left->child[tree][1], right);
+        update(tree, left);
+        return left;
+    }
+    right->child[tree][0] = merge(tree, left, right->child[tree][0]);
+    update(tree, right);
+    return right;
+}
+
+static struct FreeExtent *insertNode(int tree, struct FreeExtent *root, struct FreeExtent *node)
+{
+    if (root == NULL)
+    {
+        node->child[tree][0] = NULL;
+        node->child[tree][1] = NULL;
+        update(tree, node);
+        return node;
+    }
+    if (node->priority > root->priority)
+    {
+        split(tree, root, node, &node->child[tree][0], &node->child[tree][1]);
+        update(tree, node);
+        return node;
+    }
+    int side = compareExtents(tree, node, root) > 0;
+    root->child[tree][side] = insertNode(tree, root->child[tree][side], node);
+    update(tree, root);
+    return root;
+}
+
+static struct FreeExtent *eraseNode(int tree, struct FreeExtent *root, struct FreeExtent *node)
+{
+    if (root == node)
+    {
+        return merge(tree, node->child[tree][0], node->child[tree][1]);
+    }
+    int side = compareExtents(tree, node, root) > 0;
+    root->child[tree][side] = eraseNode(tree, root->child[tree][side], node);
+    update(tree, root);
+    return root;
+}
+
+static void linkExtent(struct FreeExtentIndex *index, struct FreeExtent *extent)
+{
+    index->root[BY_START] = insertNode(BY_START, index->root[BY_START], extent);
+    index->root[BY_LENGTH] = insertNode(BY_LENGTH, index->root[BY_LENGTH], extent);
+}
+
+static void unlinkExtent(struct FreeExtentIndex *index, struct FreeExtent *extent)
+{
+    index->root[BY_START] = eraseNode(BY_START, index->root[BY_START], extent);
+    index->root[BY_LENGTH] = eraseNode(BY_LENGTH, index->root[BY_LENGTH], extent);
+}
+
+static void addExtent(struct FreeExtentIndex *index, int start, int length)
+{
+    struct FreeExtent *extent = malloc(sizeof(struct FreeExtent));
+    extent->start = start;
+    extent->length = length;
+    extent->priority = nextPriority(index);
+    linkExtent(index, extent);
+    index->extentCount++;
+}
+
+static void destroyTree(struct FreeExtent *node)
+{
+    if (node == NULL)
+        return;
+    destroyTree(node->child[BY_START][0]);
+    destroyTree(node->child[BY_START][1]);
+    free(node);
+}
+
+// Lowest-addressed extent at or after block 'from' holding at least 'length' blocks
+static struct FreeExtent *findFrom(struct FreeExtent *node, int from, int length)
+{
+    if (node == NULL || node->maxLength < length)
+        return NULL;
+    blocksScanned++;
+
+    if (node->start < from)
+        return findFrom(node->child[BY_START][1], from, length);
+
+    struct FreeExtent *found = findFrom(node->child[BY_START][0], from, length);
+    if (found != NULL)
+        return found;
+    if (node->length >= length)
+        return node;
+    return findFrom(node->child[BY_START][1], from, length);
+}
+
+// Shortest extent holding at least 'length' blocks, lowest start on ties
+static struct FreeExtent *findBest(struct FreeExtent *node, int length)
+{
+    struct FreeExtent *best = NULL;
+    while (node != NULL)
+    {
+        blocksScanned++;
+        if (node->length >= length)
+        {
+            best = node;
+            node = node->child[BY_LENGTH][0];
+        }
+        else
+        {
+            node = node->child[BY_LENGTH][1];
+        }
+    }
+    return best;
+}
+
+static struct FreeExtent *findLongest(struct FreeExtent *node)
+{
+    while (node != NULL && node->child[BY_LENGTH][1] != NULL)
+    {
+        node = node->child[BY_LENGTH][1];
+    }
+    return node;
+}
+
+// Closest extents strictly before and after block 'start'
+static void findNeighbours(struct FreeExtent *node, int start,
+                           struct FreeExtent **before, struct FreeExtent **after)
+{
+    *before = NULL;
+    *after = NULL;
+    while (node != NULL)
+    {
+        blocksScanned++;
+        if (node->start < start)
+        {
+            *before = node;
+            node = node->child[BY_START][1];
+        }
+        else
+        {
+            if (node->start > start)
+                *after = node;
+            node = node->child[BY_START][0];
+        }
+    }
+}
+
+void extentIndexInit(struct FreeExtentIndex *index, int diskSize)
+{
+    index->root[BY_START] = NULL;
+    index->root[BY_LENGTH] = NULL;
+    index->extentCount = 0;
+    index->freeBlocks = diskSize;
+    index->nextFitCursor = 0;
+    index->seed = 2463534242u;
+    if (diskSize > 0)
+    {
+        addExtent(index, 0, diskSize);
+    }
+}
+
+void extentIndexDestroy(struct FreeExtentIndex *index)
+{
+    destroyTree(index->root[BY_START]);
+    index->root[BY_START] = NULL;
+    index->root[BY_LENGTH] = NULL;
+    index->extentCount = 0;
+    index->freeBlocks = 0;
+}
+
+// Carve 'length' contiguous blocks out of the free space.
+// Returns the first block of the run, or -1 if no extent is long enough.
+int extentAllocate(struct FreeExtentIndex *index, int length, int fitPolicy)
+{
+    if (length <= 0 || extentLargest(index) < length)
+    {
+        return -1; // Fails without searching when nothing can fit
+    }
+
+    struct FreeExtent *extent;
+    switch (fitPolicy)
+    {
+    case FIT_BEST:
+        extent = findBest(index->root[BY_LENGTH], length);
+        break;
+    case FIT_WORST:
+        extent = findLongest(index->root[BY_LENGTH]);
+        break;
+    case FIT_NEXT:
+        extent = findFrom(index->root[BY_START], index->nextFitCursor, length);
+        if (extent == NULL)
+        {
+            extent = findFrom(index->root[BY_START], 0, length); // Wrap around
+        }
+        break;
+    default:
+        extent = findFrom(index->root[BY_START], 0, length);
+        break;
+    }
+
+    int start = extent->start;
+    unlinkExtent(index, extent);
+    if (extent->length > length)
+    {
+        extent->start += length;
+        extent->length -= length;
+        linkExtent(index, extent);
+    }
+    else
+    {
+        free(extent);
+        index->extentCount--;
+    }
+
+    index->freeBlocks -= length;
+    index->nextFitCursor = start + length;
+    return start;
+}
+
+// Return blocks [start, start + length) to the free space, merging with
+// the free extents on either side.
+void extentRelease(struct FreeExtentIndex *index, int start, int length)
+{
+    if (length <= 0)
+        return;
+
+    struct FreeExtent *before, *after;
+    findNeighbours(index->root[BY_START], start, &before, &after);
+    index->freeBlocks += length;
+
+    int joinsBefore = before != NULL && before->start + before->length == start;
+    int joinsAfter = after != NULL && start + length == after->start;
+
+    if (joinsBefore && joinsAfter)
+    {
+        unlinkExtent(index, before);
+        unlinkExtent(index, after);
+        before->length += length + after->length;
+        linkExtent(index, before);
+        free(after);
+        index->extentCount--;
+    }
+    else if (joinsBefore)
+    {
+        unlinkExtent(index, before);
+        before->length += length;
+        linkExtent(index, before);
+    }
+    else if (joinsAfter)
+    {
+        unlinkExtent(index, after);
+        after->start = start;
+        after->length += length;
+        linkExtent(index, after);
+    }
+    else
+    {
+        addExtent(index, start, length);
+    }
+}
+
+// Take the specific blocks [start, start + length) out of the free space.
+// Returns -1 if any of them is not free.
+int extentReserve(struct FreeExtentIndex *index, int start, int length)
+{
+    if (length <= 0)
+        return -1;
+
+    // The only extent that can hold 'start' is the last one starting at or before it
+    struct FreeExtent *before, *after;
+    findNeighbours(index->root[BY_START], start + 1, &before, &after);
+    if (before == NULL || before->start + before->length < start + length)
+        return -1;
+
+    int tailStart = start + length;
+    int tailLength = before->start + before->length - tailStart;
+
+    unlinkExtent(index, before);
+    if (before->start < start)
+    {
+        before->length = start - before->start;
+        linkExtent(index, before);
+    }
+    else
+    {
+        free(before);
+        index->extentCount--;
+    }
+    if (tailLength > 0)
+    {
+        addExtent(index, tailStart, tailLength);
+    }
+
+    index->freeBlocks -= length;
+    return 0;
+}
+
+int extentLargest(const struct FreeExtentIndex *index)
+{
+    const struct FreeExtent *root = index->root[BY_START];
+    return root != NULL ? root->maxLength : 0;
+}
+
+// FIT_* for "first", "best", "worst" or "next", or -1
+int fitPolicyKind(const char *name)
+{
+    static const char *names[] = {"first", "best", "worst", "next"};
+    for (int policy = FIT_FIRST; policy <= FIT_NEXT; policy++)
+    {
+        if (strcmp(name, names[policy]) == 0)
+            return policy;
+    }
+    return -1;
+}
+
+const char *fitPolicyName(int fitPolicy)
+{
+    switch (fitPolicy)
+    {
+    case FIT_BEST:
+        return "Best fit";
+    case FIT_WORST:
+        return "Worst fit";
+    case FIT_NEXT:
+        return "Next fit";
+    default:
+        return "First fit";
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef FREE_EXTENTS_H
+#define FREE_EXTENTS_H
+
+// Fit policies for extentAllocate
+#define FIT_FIRST 0
+#define FIT_BEST 1
+#define FIT_WORST 2
+#define FIT_NEXT 3
+
+// A run of free blocks. Every extent sits in two treaps at once: one ordered
+// by start block (augmented with the largest length in each subtree) and one
+// ordered by (length, start).
+struct FreeExtent
+{
+    int start;
+    int length;
+    int maxLength;                // Largest length in this node's by-start subtree
+    unsigned int priority;        // Heap priority, shared by both treaps
+    struct FreeExtent *child[2][2]; // child[tree][0]: left, child[tree][1]: right
+};
+
+struct FreeExtentIndex
+{
+    struct FreeExtent *root[2]; // root[0]: by start, root[1]: by length
+    int extentCount;
+    int freeBlocks;
+    int nextFitCursor; // Block after the last allocation, used by FIT_NEXT
+    unsigned int seed; // Priority generator state
+};
+
+void extentIndexInit(struct FreeExtentIndex *index, int diskSize);
+void extentIndexDestroy(struct FreeExtentIndex *index);
+int extentAllocate(struct FreeExtentIndex *index, int length, int fitPolicy);
+void extentRelease(struct FreeExtentIndex *index, int start, int length);
+int extentReserve(struct FreeExtentIndex *index, int start, int length);
+int extentLargest(const struct FreeExtentIndex *index);
+int fitPolicyKind(const char *name);
+const char *fitPolicyName(int fitPolicy);
+
+#endif
@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <cstring>
+
+#include "fsalloc.hpp"
+
+namespace fsalloc
+{
+
+namespace
+{
+
+template <class Policy>
+std::unique_ptr<Allocator> make(const SimOptions &options)
+{
+    static bool made = false; // The simulator's globals can only be set up once
+    if (made)
+    {
+        std::fprintf(stderr, "%s has already been set up in this process\n", Policy::name());
+        return nullptr;
+    }
+    if (Policy::setup(&options) != 0)
+        return nullptr;
+    made = true;
+    return std::unique_ptr<Allocator>(new PolicyAllocator<Policy>());
+}
+
+} // namespace
+
+std::unique_ptr<Allocator> makeAllocator(const char *name, const SimOptions &options)
+{
+    if (std::strcmp(name, "sequential") == 0)
+        return make<Sequential>(options);
+    if (std::strcmp(name, "linked") == 0)
+        return make<Linked>(options);
+    if (std::strcmp(name, "linked-fat") == 0)
+        return make<LinkedFat>(options);
+    if (std::strcmp(name, "indexed") == 0)
+        return make<Indexed>(options);
+    if (std::strcmp(name, "inode") == 0)
+        return make<Inode>(options);
+    if (std::strcmp(name, "indexed-concurrent") == 0)
+        return make<IndexedConcurrent>(options);
+    std::fprintf(stderr, "Unknown strategy '%s'\n", name);
+    return nullptr;
+}
+
+} // namespace fsalloc
@@ -0,0 +1,262 @@
+#ifndef FSALLOC_HPP
+#define FSALLOC_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "bench.h"
+#include "console.h"
+#include "device.h"
+#include "metrics.h"
+#include "options.h"
+#include "strategy.h"
+#include "trace.h"
+#include "workload.h"
+
+// C++ front end to the simulators. Every strategy is a policy: a struct of
+// static functions that call its C entry points (strategy.h). The benchmark
+// and trace loops below are templates over the policy, so each operation is
+// a direct call the compiler can inline, and the Allocator interface only
+// dispatches once per run.
+namespace fsalloc
+{
+
+struct Sequential
+{
+    static int setup(const SimOptions *options) { return sequentialSetup(options); }
+    static const char *name() { return sequentialName(); }
+    static int insertFile(const char *name, int blocks) { return sequentialInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return sequentialDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return sequentialAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return sequentialAppendFile(name, blocks); }
+    static size_t metadataBytes() { return sequentialMetadataBytes(); }
+    static void close() {}
+};
+
+struct Linked
+{
+    static int setup(const SimOptions *options) { return linkedSetup(options); }
+    static const char *name() { return linkedName(); }
+    static int insertFile(const char *name, int blocks) { return linkedInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return linkedDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return linkedAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return linkedAppendFile(name, blocks); }
+    static size_t metadataBytes() { return linkedMetadataBytes(); }
+    static void close() {}
+};
+
+struct LinkedFat
+{
+    static int setup(const SimOptions *options) { return linkedFatSetup(options); }
+    static const char *name() { return linkedFatName(); }
+    static int insertFile(const char *name, int blocks) { return linkedFatInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return linkedFatDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return linkedFatAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return linkedFatAppendFile(name, blocks); }
+    static size_t metadataBytes() { return linkedFatMetadataBytes(); }
+    static void close() { linkedFatClose(); }
+};
+
+struct Indexed
+{
+    static int setup(const SimOptions *options) { return indexedSetup(options); }
+    static const char *name() { return indexedName(); }
+    static int insertFile(const char *name, int blocks) { return indexedInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return indexedDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return indexedAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return indexedAppendFile(name, blocks); }
+    static size_t metadataBytes() { return indexedMetadataBytes(); }
+    static void close() {}
+};
+
+struct Inode
+{
+    static int setup(const SimOptions *options) { return inodeSetup(options); }
+    static const char *name() { return inodeName(); }
+    static int insertFile(const char *name, int blocks) { return inodeInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return inodeDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return inodeAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return inodeAppendFile(name, blocks); }
+    static size_t metadataBytes() { return inodeMetadataBytes(); }
+    static void close() {}
+};
+
+struct IndexedConcurrent
+{
+    static int setup(const SimOptions *options) { return indexedConcurrentSetup(options); }
+    static const char *name() { return indexedConcurrentName(); }
+    static int insertFile(const char *name, int blocks) { return indexedConcurrentInsertFile(name, blocks); }
+    static int deleteFile(const char *name) { return indexedConcurrentDeleteFile(name); }
+    static int accessFile(const char *name, int offset) { return indexedConcurrentAccessFile(name, offset); }
+    static int appendFile(const char *name, int blocks) { return indexedConcurrentAppendFile(name, blocks); }
+    static size_t metadataBytes() { return indexedConcurrentMetadataBytes(); }
+    static void close() {}
+};
+
+// applyTraceOp with the handlers resolved at compile time
+template <class Policy>
+inline int applyOp(const TraceOp &op, ReplayStats &stats)
+{
+    int result;
+    switch (op.type)
+    {
+    case TRACE_INSERT:
+        result = Policy::insertFile(op.name, op.value);
+        break;
+    case TRACE_DELETE:
+        result = Policy::deleteFile(op.name);
+        break;
+    case TRACE_ACCESS:
+        result = Policy::accessFile(op.name, op.value);
+        break;
+    default:
+        result = Policy::appendFile(op.name, op.value);
+        break;
+    }
+
+    stats.count[op.type]++;
+    if (result == -1)
+        stats.failed[op.type]++;
+    return result;
+}
+
+// Same workload, timing and CSV row as the C runBenchmark (bench.c)
+template <class Policy>
+int runBenchmark(const SimOptions &options)
+{
+    Workload workload;
+    if (workloadInit(&workload, options.workload, options.blockCount, options.fillPercent, options.benchOperations) == -1)
+    {
+        std::fprintf(stderr, "Out of memory for the workload\n");
+        return -1;
+    }
+
+    ReplayStats stats;
+    std::memset(&stats, 0, sizeof(stats));
+    TraceOp op;
+    bool measuring = options.workload == WORKLOAD_FILL;
+    unsigned long long scannedAtStart = blocksScanned;
+    DeviceSample deviceAtStart;
+    deviceSample(&device, &deviceAtStart);
+
+    consoleQuiet = 1;
+    double start = wallSeconds();
+    while (workloadNext(&workload, &op))
+    {
+        if (!measuring && !workload.filling)
+        {
+            measuring = true;
+            std::memset(&stats, 0, sizeof(stats));
+            scannedAtStart = blocksScanned;
+            deviceSample(&device, &deviceAtStart);
+            start = wallSeconds();
+        }
+        int result = applyOp<Policy>(op, stats);
+        workloadResult(&workload, &op, result);
+    }
+    stats.seconds = wallSeconds() - start;
+    stats.deviceMs = device.clockMs - deviceAtStart.clockMs;
+    consoleQuiet = 0;
+    workloadDestroy(&workload);
+
+    return reportBenchmark(Policy::name(), &options, 1, &stats, blocksScanned - scannedAtStart, Policy::metadataBytes(),
+                           &deviceAtStart);
+}
+
+// The thread-safe strategy runs options.threads threads (bench.c)
+template <>
+inline int runBenchmark<IndexedConcurrent>(const SimOptions &options)
+{
+    TraceHandlers handlers = {IndexedConcurrent::insertFile, IndexedConcurrent::deleteFile,
+                              IndexedConcurrent::accessFile, IndexedConcurrent::appendFile};
+    return runConcurrentBenchmark(IndexedConcurrent::name(), &handlers, IndexedConcurrent::metadataBytes,
+                                  indexedConcurrentFlushThread, &options);
+}
+
+// Same as the C replayTrace (trace.c)
+template <class Policy>
+int replayTrace(const char *path)
+{
+    FILE *trace = std::fopen(path, "r");
+    if (trace == nullptr)
+    {
+        std::perror(path);
+        return -1;
+    }
+
+    ReplayStats stats = {{0}, {0}, 0, 0};
+    TraceOp op;
+    char line[256];
+    long long lineNumber = 0;
+
+    consoleQuiet = 1;
+    double deviceStart = device.clockMs;
+    double start = wallSeconds();
+    while (std::fgets(line, sizeof(line), trace) != nullptr)
+    {
+        lineNumber++;
+        int parsed = parseTraceLine(line, &op);
+        if (parsed == 1)
+        {
+            applyOp<Policy>(op, stats);
+        }
+        else if (parsed == -1)
+        {
+            std::fprintf(stderr, "%s:%lld: malformed operation skipped\n", path, lineNumber);
+        }
+    }
+    stats.seconds = wallSeconds() - start;
+    stats.deviceMs = device.clockMs - deviceStart;
+    consoleQuiet = 0;
+
+    std::fclose(trace);
+    if constexpr (std::is_same_v<Policy, IndexedConcurrent>)
+        indexedConcurrentFlushThread();
+    printReplayStats(&stats);
+    return 0;
+}
+
+// One strategy behind a common interface, for code that picks the strategy
+// at run time. The per-file calls are virtual; runBenchmark and replayTrace
+// make one virtual call and then run the policy's own loop.
+class Allocator
+{
+public:
+    virtual ~Allocator() = default;
+    virtual const char *name() const = 0;
+    virtual int insertFile(const char *name, int blocks) = 0;
+    virtual int deleteFile(const char *name) = 0;
+    virtual int accessFile(const char *name, int offset) = 0;
+    virtual int appendFile(const char *name, int blocks) = 0;
+    virtual size_t metadataBytes() const = 0;
+    virtual int runBenchmark(const SimOptions &options) = 0;
+    virtual int replayTrace(const char *path) = 0;
+};
+
+template <class Policy>
+class PolicyAllocator final : public Allocator
+{
+public:
+    ~PolicyAllocator() override { Policy::close(); }
+    const char *name() const override { return Policy::name(); }
+    int insertFile(const char *name, int blocks) override { return Policy::insertFile(name, blocks); }
+    int deleteFile(const char *name) override { return Policy::deleteFile(name); }
+    int accessFile(const char *name, int offset) override { return Policy::accessFile(name, offset); }
+    int appendFile(const char *name, int blocks) override { return Policy::appendFile(name, blocks); }
+    size_t metadataBytes() const override { return Policy::metadataBytes(); }
+    int runBenchmark(const SimOptions &options) override { return fsalloc::runBenchmark<Policy>(options); }
+    int replayTrace(const char *path) override { return fsalloc::replayTrace<Policy>(path); }
+};
+
+// Set up the strategy called 'name' (sequential, linked, linked-fat, indexed,
+// inode or indexed-concurrent; the options pick its variant) and return it, or nullptr if the
+// name is unknown or setup fails. Each simulator keeps its disk in globals,
+// so a strategy can only be made once per process, and the strategies share
+// the device model: make and run them one at a time.
+std::unique_ptr<Allocator> makeAllocator(const char *name, const SimOptions &options);
+
+} // namespace fsalloc
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "index-pool.h"
+
+#define MIN_CHUNK_SHIFT 3 // Smallest chunk holds 8 entries
+
+static int sizeClass(size_t count)
+{
+    int shift = MIN_CHUNK_SHIFT;
+    while (((size_t)1 << shift) < count)
+    {
+        shift++;
+    }
+    return shift - MIN_CHUNK_SHIFT;
+}
+
+int indexPoolInit(struct IndexPool *pool)
+{
+    pool->capacity = 1024;
+    pool->length = 0;
+    pool->entries = malloc(sizeof(uint32_t) * pool->capacity);
+    for (int i = 0; i < INDEX_POOL_CLASSES; i++)
+    {
+        pool->freeLists[i] = INDEX_POOL_NONE;
+    }
+    return pool->entries != NULL ? 0 : -1;
+}
+
+void indexPoolDestroy(struct IndexPool *pool)
+{
+    free(pool->entries);
+    pool->entries = NULL;
+    pool->length = 0;
+    pool->capacity = 0;
+}
+
+// Chunk with room for 'count' block numbers, reused from the free list when
+// possible. Returns INDEX_POOL_NONE if out of memory.
+uint32_t indexPoolAlloc(struct IndexPool *pool, size_t count)
+{
+    int class = sizeClass(count);
+    size_t size = (size_t)1 << (class + MIN_CHUNK_SHIFT);
+    uint32_t chunk = pool->freeLists[class];
+    if (chunk != INDEX_POOL_NONE)
+    {
+        pool->freeLists[class] = pool->entries[chunk];
+        return chunk;
+    }
+
+    if (pool->length + size >= INDEX_POOL_NONE)
+        return INDEX_POOL_NONE;
+    if (pool->length + size > pool->capacity)
+    {
+        size_t capacity = pool->capacity;
+        while (capacity < pool->length + size)
+        {
+            capacity *= 2;
+        }
+        uint32_t *entries = realloc(pool->entries, sizeof(uint32_t) * capacity);
+        if (entries == NULL)
+            return INDEX_POOL_NONE;
+        pool->entries = entries;
+        pool->capacity = capacity;
+    }
+    chunk = (uint32_t)pool->length;
+    pool->length += size;
+    return chunk;
+}
+
+// Return a chunk allocated for 'count' block numbers to its free list
+void indexPoolFree(struct IndexPool *pool, uint32_t chunk, size_t count)
+{
+    int class = sizeClass(count);
+    pool->entries[chunk] = pool->freeLists[class];
+    pool->freeLists[class] = chunk;
+}
+
+// Make room for 'count' entries in a chunk holding 'used' of them, moving it
+// to a larger chunk if needed. Returns the chunk to use from now on, or
+// INDEX_POOL_NONE (leaving the old one intact) if out of memory.
+uint32_t indexPoolGrow(struct IndexPool *pool, uint32_t chunk, size_t used, size_t count)
+{
+    if (sizeClass(count) == sizeClass(used))
+        return chunk;
+
+    uint32_t grown = indexPoolAlloc(pool, count);
+    if (grown == INDEX_POOL_NONE)
+        return INDEX_POOL_NONE;
+    memcpy(pool->entries + grown, pool->entries + chunk, sizeof(uint32_t) * used);
+    indexPoolFree(pool, chunk, used);
+    return grown;
+}
+
+size_t indexPoolBytes(const struct IndexPool *pool)
+{
+    return sizeof(uint32_t) * pool->capacity;
+}
@@ -0,0 +1,35 @@
+#ifndef INDEX_POOL_H
+#define INDEX_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INDEX_POOL_CLASSES 32
+#define INDEX_POOL_NONE UINT32_MAX
+
+// Index-block contents kept apart from the disk: one shared array of 32-bit
+// block numbers carved into power-of-two chunks (8 entries and up). Freed
+// chunks go on a free list per size, linked through their first entry.
+// Chunks are named by their offset in the array, which stays valid when the
+// array grows.
+struct IndexPool
+{
+    uint32_t *entries;
+    size_t length;   // Entries handed out so far, free chunks included
+    size_t capacity; // Entries allocated
+    uint32_t freeLists[INDEX_POOL_CLASSES];
+};
+
+int indexPoolInit(struct IndexPool *pool);
+void indexPoolDestroy(struct IndexPool *pool);
+uint32_t indexPoolAlloc(struct IndexPool *pool, size_t count);
+void indexPoolFree(struct IndexPool *pool, uint32_t chunk, size_t count);
+uint32_t indexPoolGrow(struct IndexPool *pool, uint32_t chunk, size_t used, size_t count);
+size_t indexPoolBytes(const struct IndexPool *pool);
+
+static inline uint32_t *indexPoolChunk(const struct IndexPool *pool, uint32_t chunk)
+{
+    return pool->entries + chunk;
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "block-pool.h"
+#include "console.h"
+#include "metrics.h"
+#include "options.h"
+#include "sharded-directory.h"
+#include "strategy.h"
+#include "trace.h"
+
+// Thread-safe indexed allocation. Every file has a list of linked index
+// blocks, each listing ptrsPerBlock data blocks. Blocks come from the
+// calling thread's batch (block-pool.h) and files are found through a
+// sharded directory: an operation holds only its file's shard lock, so
+// threads working on different files run in parallel. The device model
+// keeps a single head position, so this strategy does not charge it.
+struct FileEntry
+{
+    char *name;       // File name, NULL for a free slot
+    int *blocks;      // Data blocks in file order
+    int blockCount;
+    int *indexBlocks; // Linked index blocks in list order
+    int indexCount;
+    int capacity;     // Entries allocated in 'blocks'
+};
+
+static int diskSize;     // Number of blocks, set from the command line
+static int maxFiles;     // Number of file slots
+static int ptrsPerBlock; // Block numbers that fit in one index block
+static struct BlockPool pool;
+static struct FileEntry *files;
+static struct ShardedDirectory directory; // Name -> file slot, one lock per shard
+static long long listBytes;  // Memory held by the files' block lists, updated atomically
+static int threadsSeen;      // Threads that have taken a batch, updated atomically
+
+static _Thread_local struct BlockBatch batch;
+static _Thread_local int batchReady;
+
+static void init()
+{
+    files = calloc(maxFiles, sizeof(struct FileEntry));
+    if (files == NULL || blockPoolInit(&pool, diskSize) != 0 || shardedDirectoryInit(&directory, maxFiles) != 0)
+    {
+        printf("Not enough memory for a %d-block disk\n", diskSize);
+        exit(1);
+    }
+}
+
+// The calling thread's batch, started at a cursor spread over the disk so
+// threads claim from different parts of the bitmap
+static struct BlockBatch *threadBatch()
+{
+    if (!batchReady)
+    {
+        unsigned long long thread = __atomic_fetch_add(&threadsSeen, 1, __ATOMIC_RELAXED);
+        blockBatchInit(&batch, (int)(thread * 2654435761u % (unsigned long long)diskSize));
+        batchReady = 1;
+    }
+    return &batch;
+}
+
+// Index blocks a file of 'blocks' data blocks needs
+static int indexBlocksFor(int blocks)
+{
+    return blocks <= ptrsPerBlock ? 1 : (blocks + ptrsPerBlock - 1) / ptrsPerBlock;
+}
+
+static void releaseBlocks(const int *blocks, int count)
+{
+    struct BlockBatch *mine = threadBatch();
+    for (int i = 0; i < count; i++)
+    {
+        blockPoolGive(&pool, mine, blocks[i]);
+    }
+}
+
+// Grow a file by 'count' data blocks plus the index blocks they need.
+// Returns -1 with the file unchanged if the blocks or memory run out.
+static int addBlocks(struct FileEntry *file, int count)
+{
+    int indexNeeded = indexBlocksFor(file->blockCount + count);
+    struct BlockBatch *mine = threadBatch();
+    if (blockPoolFree(&pool, mine) < count + indexNeeded - file->indexCount)
+        return -1;
+
+    // Every file has at least one index block, so the index list is
+    // allocated even when no data blocks are added
+    if (file->blockCount + count > file->capacity || file->indexBlocks == NULL)
+    {
+        int capacity = file->capacity > 0 ? file->capacity : 8;
+        while (capacity < file->blockCount + count)
+            capacity *= 2;
+        int *blocks = realloc(file->blocks, sizeof(int) * capacity);
+        int *indexBlocks = realloc(file->indexBlocks, sizeof(int) * indexBlocksFor(capacity));
+        if (blocks != NULL)
+            file->blocks = blocks;
+        if (indexBlocks != NULL)
+            file->indexBlocks = indexBlocks;
+        if (blocks == NULL || indexBlocks == NULL)
+            return -1;
+        __atomic_fetch_add(&listBytes, (long long)(sizeof(int) * (capacity - file->capacity)), __ATOMIC_RELAXED);
+        file->capacity = capacity;
+    }
+
+    // Another thread may have taken the last blocks since the check
+    int indexTaken = file->indexCount, taken = file->blockCount;
+    while (indexTaken < indexNeeded)
+    {
+        int block = blockPoolTake(&pool, mine);
+        if (block == -1)
+            break;
+        file->indexBlocks[indexTaken++] = block;
+    }
+    while (indexTaken == indexNeeded && taken < file->blockCount + count)
+    {
+        int block = blockPoolTake(&pool, mine);
+        if (block == -1)
+            break;
+        file->blocks[taken++] = block;
+    }
+    if (taken < file->blockCount + count)
+    {
+        releaseBlocks(file->indexBlocks + file->indexCount, indexTaken - file->indexCount);
+        releaseBlocks(file->blocks + file->blockCount, taken - file->blockCount);
+        return -1;
+    }
+    file->indexCount = indexNeeded;
+    file->blockCount = taken;
+    return 0;
+}
+
+static int insertFile(const char *name, int blocks)
+{
+    if (blocks <= 0)
+    {
+        consolePrintf("\nInvalid number of blocks\n");
+        return -1;
+    }
+
+    struct DirectoryShard *shard = shardedDirectoryShard(&directory, name);
+    pthread_mutex_lock(&shard->lock);
+    int result = -1;
+    int slot = directoryNextSlot(&shard->directory);
+    if (directoryLookup(&shard->directory, name) != -1)
+    {
+        consolePrintf("\nFile already exists\n");
+    }
+    else if (slot == -1)
+    {
+        consolePrintf("\nNo free file slots\n");
+    }
+    else
+    {
+        struct FileEntry *file = &files[shard->firstSlot + slot];
+        file->name = strdup(name);
+        if (file->name == NULL || addBlocks(file, blocks) != 0)
+        {
+            consolePrintf("\nFile size too big (need %d blocks)\n", blocks + indexBlocksFor(blocks));
+            free(file->name);
+            file->name = NULL;
+        }
+        else
+        {
+            directoryAdd(&shard->directory, file->name);
+            consolePrintf("File inserted successfully\n");
+            result = 0;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return result;
+}
+
+static int deleteFile(const char *name)
+{
+    struct DirectoryShard *shard = shardedDirectoryShard(&directory, name);
+    pthread_mutex_lock(&shard->lock);
+    int slot = directoryRemove(&shard->directory, name);
+    if (slot == -1)
+    {
+        pthread_mutex_unlock(&shard->lock);
+        consolePrintf("\nFile not found\n");
+        return -1;
+    }
+
+    struct FileEntry *file = &files[shard->firstSlot + slot];
+    releaseBlocks(file->indexBlocks, file->indexCount);
+    releaseBlocks(file->blocks, file->blockCount);
+    threadBatch()->scanned += file->indexCount + file->blockCount;
+    __atomic_fetch_sub(&listBytes, (long long)(sizeof(int) * file->capacity), __ATOMIC_RELAXED);
+    free(file->blocks);
+    free(file->indexBlocks);
+    free(file->name);
+    memset(file, 0, sizeof(*file));
+    pthread_mutex_unlock(&shard->lock);
+
+    consolePrintf("\nFile deleted successfully\n");
+    return 0;
+}
+
+static int appendFile(const char *name, int blocks)
+{
+    struct DirectoryShard *shard = shardedDirectoryShard(&directory, name);
+    pthread_mutex_lock(&shard->lock);
+    int slot = directoryLookup(&shard->directory, name);
+    int result = -1;
+    if (slot == -1)
+    {
+        consolePrintf("\nFile not found\n");
+    }
+    else if (blocks <= 0 || addBlocks(&files[shard->firstSlot + slot], blocks) != 0)
+    {
+        consolePrintf("\nFile size too big (need %d blocks)\n", blocks);
+    }
+    else
+    {
+        consolePrintf("File extended successfully\n");
+        result = 0;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return result;
+}
+
+// Block holding block 'offset' of the file, found by following the list
+// of index blocks. Returns -1 if there is no such block.
+static int accessFile(const char *name, int offset)
+{
+    struct DirectoryShard *shard = shardedDirectoryShard(&directory, name);
+    pthread_mutex_lock(&shard->lock);
+    int slot = directoryLookup(&shard->directory, name);
+    int block = -1;
+    if (slot != -1 && offset >= 0 && offset < files[shard->firstSlot + slot].blockCount)
+    {
+        threadBatch()->scanned += offset / ptrsPerBlock + 1;
+        block = files[shard->firstSlot + slot].blocks[offset];
+    }
+    pthread_mutex_unlock(&shard->lock);
+    if (block == -1)
+        consolePrintf("Invalid file or block index!\n");
+    return block;
+}
+
+// Return the calling thread's batch to the bitmap and add the blocks it
+// scanned to blocksScanned
+static void flushThread()
+{
+    struct BlockBatch *mine = threadBatch();
+    blockPoolFlush(&pool, mine);
+    __atomic_fetch_add(&blocksScanned, mine->scanned, __ATOMIC_RELAXED);
+    mine->scanned = 0;
+}
+
+static size_t metadataBytes()
+{
+    return sizeof(struct FileEntry) * maxFiles + blockPoolBytes(&pool) + shardedDirectoryBytes(&directory) +
+           (size_t)__atomic_load_n(&listBytes, __ATOMIC_RELAXED);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int indexedConcurrentSetup(const struct SimOptions *options)
+{
+    diskSize = options->blockCount;
+    maxFiles = options->maxFiles;
+    ptrsPerBlock = options->blockSize / sizeof(int);
+
+    init();
+    return 0;
+}
+
+const char *indexedConcurrentName()
+{
+    return "indexed-concurrent";
+}
+
+int indexedConcurrentInsertFile(const char *name, int blocks)
+{
+    return insertFile(name, blocks);
+}
+
+int indexedConcurrentDeleteFile(const char *name)
+{
+    return deleteFile(name);
+}
+
+int indexedConcurrentAccessFile(const char *name, int offset)
+{
+    return accessFile(name, offset);
+}
+
+int indexedConcurrentAppendFile(const char *name, int blocks)
+{
+    return appendFile(name, blocks);
+}
+
+size_t indexedConcurrentMetadataBytes()
+{
+    return metadataBytes();
+}
+
+void indexedConcurrentFlushThread()
+{
+    flushThread();
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
+{
+    struct SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0 || indexedConcurrentSetup(&options) != 0)
+    {
+        return 1;
+    }
+    struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+    if (options.workload != -1)
+    {
+        return runConcurrentBenchmark(indexedConcurrentName(), &handlers, metadataBytes, flushThread, &options) == 0 ? 0 : 1;
+    }
+    if (options.traceFile != NULL)
+    {
+        int result = replayTrace(options.traceFile, &handlers);
+        flushThread();
+        return result == 0 ? 0 : 1;
+    }
+    printf("%s has no menu: run a benchmark (-w) or replay a trace (-t)\n", argv[0]);
+    return 1;
+}
+#endif
@@ -1,186 +1,502 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <unistd.h>
 
-#define maxsize 100
-#define MAX_FILES 30
-#define MAX_BLOCK_PTRS maxsize
+#include "bench.h"
+#include "bitmap.h"
+#include "console.h"
+#include "device.h"
+#include "directory.h"
+#include "index-pool.h"
+#include "lru.h"
+#include "metrics.h"
+#include "options.h"
+#include "strategy.h"
+#include "trace.h"
 
 #define DATA_BLOCK_TYPE 0
 #define INDEX_BLOCK_TYPE 1
 
-union BlockContent
-{
-    int data;                                // For DATA_BLOCK
-    struct Block *blockPtrs[MAX_BLOCK_PTRS]; // For INDEX_BLOCK
-};
+// Linked index blocks: the first two pool entries link to the next index
+// block (its disk block and its pool chunk), data block numbers follow
+#define NEXT_BLOCK 0
+#define NEXT_CHUNK 1
+#define LINK_HEADER 2
 
-struct Block
-{
-    int type; // DATA_BLOCK (0) or INDEX_BLOCK (1)
-    union BlockContent content;
-};
+// Index blocks kept in memory; a cached index block costs no device read
+#define INDEX_CACHE_BLOCKS 64
 
+// Pool layout of an index block: a leaf lists ptrsPerBlock data blocks, an
+// interior index block lists ptrsPerBlock child index blocks followed by
+// their pool chunks. Only a depth-one root grows with the file, every other
+// index block gets a full-size chunk.
 struct FileEntry
 {
-    char *name;     // File name
-    int indexBlock; // Index block location
+    char *name;      // File name
+    int indexBlock;  // Root (or first linked) index block location
+    int blocks;      // Data blocks in the file
+    uint32_t chunk;  // Contents of the root index block in the index pool
+    int depth;       // Tree: levels of index blocks in use
+    uint32_t tail;   // Linked: chunk of the last index block in the list
 };
 
-struct Block disk[maxsize];
-int freeSpace = maxsize;
-struct FileEntry files[MAX_FILES];
-
-void init()
+static int diskSize;     // Number of blocks, set from the command line
+static int maxFiles;     // Number of file slots
+static int ptrsPerBlock; // Block numbers that fit in one index block
+static int indexLevels;  // Most levels of index blocks, or INDEX_LINKED
+static unsigned char *blockTypes; // DATA_BLOCK_TYPE or INDEX_BLOCK_TYPE for each block
+static struct IndexPool indexPool; // Block numbers listed by the index blocks
+static struct LruCache indexCache; // Index blocks recently read
+static struct Bitmap usedBlocks; // One bit per block: 0 free, 1 used
+static int freeSpace;
+static int nextFree; // Where the next free-block search starts
+static struct FileEntry *files;
+static struct Directory directory; // Name -> file slot index and free-slot stack
+
+static void init()
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    blockTypes = calloc(diskSize, sizeof(unsigned char)); // Every block starts as DATA_BLOCK_TYPE
+    files = malloc(sizeof(struct FileEntry) * maxFiles);
+    if (blockTypes == NULL || files == NULL || bitmapInit(&usedBlocks, diskSize) != 0 ||
+        indexPoolInit(&indexPool) != 0 || lruInit(&indexCache, INDEX_CACHE_BLOCKS) != 0 ||
+        directoryInit(&directory, maxFiles) != 0)
+    {
+        printf("Not enough memory for a %d-block disk\n", diskSize);
+        exit(1);
+    }
+    freeSpace = diskSize;
+    nextFree = 0;
+
+    for (int i = 0; i < maxFiles; i++)
     {
         files[i].name = NULL;
         files[i].indexBlock = -1;
+        files[i].blocks = 0;
+        files[i].chunk = INDEX_POOL_NONE;
     }
+}
+
+// Take the first free block at or after *cursor, wrapping around to block
+// 0, and move the cursor past it. Callers pass nextFree, so a search resumes
+// where the last allocation stopped rather than at block 0. Callers check
+// freeSpace first, so the search always succeeds.
+static int getFreeBlock(int *cursor, int type)
+{
+    int block = bitmapFindClear(&usedBlocks, *cursor);
+    if (block == -1)
+        block = bitmapFindClear(&usedBlocks, 0);
+    bitmapSet(&usedBlocks, block);
+    blockTypes[block] = type;
+    deviceStoreRun(&device, block, 1);
+    freeSpace--;
+    *cursor = block + 1 < diskSize ? block + 1 : 0;
+    return block;
+}
+
+static void releaseBlock(int block)
+{
+    bitmapClear(&usedBlocks, block);
+    freeSpace++;
+}
+
+static void releaseIndexBlock(int block)
+{
+    blockTypes[block] = DATA_BLOCK_TYPE;
+    lruRemove(&indexCache, block);
+    releaseBlock(block);
+}
+
+static int getEmptySlot()
+{
+    return directoryNextSlot(&directory);
+}
+
+static int searchFile(const char *name)
+{
+    return directoryLookup(&directory, name);
+}
 
-    for (int i = 0; i < maxsize; i++)
+// Data blocks reachable through one index block 'level' levels above them
+static long long levelSpan(int level)
+{
+    long long span = 1;
+    while (level-- > 0)
     {
-        disk[i].type = DATA_BLOCK_TYPE;
-        disk[i].content.data = 0;
+        span *= ptrsPerBlock;
     }
+    return span;
+}
+
+static long long maxFileBlocks()
+{
+    if (indexLevels == INDEX_LINKED)
+        return INT_MAX;
+    long long span = levelSpan(indexLevels);
+    return span < INT_MAX ? span : INT_MAX;
 }
 
-int getFreeBlock()
+// Index blocks a file of 'blocks' data blocks needs
+static int indexBlocksFor(int blocks)
 {
-    for (int i = 0; i < maxsize; i++)
+    if (indexLevels == INDEX_LINKED)
+    {
+        int perBlock = ptrsPerBlock - 1;
+        return blocks <= perBlock ? 1 : (blocks + perBlock - 1) / perBlock;
+    }
+    int depth = 1;
+    while (levelSpan(depth) < blocks)
     {
-        if (disk[i].content.data == 0)
-            return i;
+        depth++;
     }
-    return -1;
+    int count = 0;
+    for (int level = 1; level <= depth; level++)
+    {
+        long long span = levelSpan(level);
+        count += blocks > span ? (int)((blocks + span - 1) / span) : 1;
+    }
+    return count;
 }
 
-int getEmptySlot()
+static uint32_t newChunk(size_t entries)
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    uint32_t chunk = indexPoolAlloc(&indexPool, entries);
+    if (chunk == INDEX_POOL_NONE)
     {
-        if (files[i].name == NULL)
-            return i;
+        printf("Not enough memory for the index pool\n");
+        exit(1);
     }
-    return -1;
+    return chunk;
 }
 
-int searchFile(char *name)
+static uint32_t growChunk(uint32_t chunk, size_t used, size_t entries)
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    chunk = indexPoolGrow(&indexPool, chunk, used, entries);
+    if (chunk == INDEX_POOL_NONE)
     {
-        if (files[i].name != NULL && strcmp(files[i].name, name) == 0)
-            return i;
+        printf("Not enough memory for the index pool\n");
+        exit(1);
     }
-    return -1;
+    return chunk;
 }
 
-void insertFile(char *name, int blocks)
+// Leaf index block that will list data block file->blocks, for a run of
+// 'count' blocks that fits in it. Index blocks are added only when a new
+// subtree starts, a new root goes on top when the tree is full, and a
+// depth-one root grows its chunk to hold the run.
+static uint32_t treeLeaf(struct FileEntry *file, int *cursor, int count)
 {
-    if (blocks + 1 > freeSpace)
+    long long offset = file->blocks;
+    if (offset == levelSpan(file->depth))
     {
-        printf("\nFile size too big (need %d blocks, only %d available)\n", blocks + 1, freeSpace);
-        return;
+        int block = getFreeBlock(cursor, INDEX_BLOCK_TYPE);
+        uint32_t root = newChunk(2 * ptrsPerBlock);
+        uint32_t *entries = indexPoolChunk(&indexPool, root);
+        entries[0] = file->indexBlock;
+        entries[ptrsPerBlock] = file->chunk;
+        file->indexBlock = block;
+        file->chunk = root;
+        file->depth++;
     }
-
-    if (searchFile(name) != -1)
+    if (file->depth == 1)
     {
-        printf("\nFile already exists\n");
-        return;
+        file->chunk = growChunk(file->chunk, offset, offset + count);
+        return file->chunk;
     }
 
-    int fileSlot = getEmptySlot();
-    if (fileSlot == -1)
+    uint32_t node = file->chunk;
+    for (int level = file->depth - 1; level > 0; level--)
     {
-        printf("\nNo free file slots\n");
-        return;
+        long long span = levelSpan(level);
+        int slot = (int)(offset / span % ptrsPerBlock);
+        if (offset % span == 0)
+        {
+            int block = getFreeBlock(cursor, INDEX_BLOCK_TYPE);
+            uint32_t child = newChunk(level > 1 ? 2 * ptrsPerBlock : ptrsPerBlock);
+            uint32_t *entries = indexPoolChunk(&indexPool, node);
+            entries[slot] = block;
+            entries[ptrsPerBlock + slot] = child;
+        }
+        node = indexPoolChunk(&indexPool, node)[ptrsPerBlock + slot];
     }
+    return node;
+}
 
-    int indexBlock = getFreeBlock();
-    if (indexBlock == -1)
+// Linked index block that will list data block file->blocks, for a run of
+// 'count' blocks that fits in it
+static uint32_t linkedLeaf(struct FileEntry *file, int *cursor, int count)
+{
+    int perBlock = ptrsPerBlock - 1; // One entry links to the next index block
+    int offset = file->blocks;
+    if (offset < perBlock)
     {
-        printf("\nNo free blocks available\n");
-        return;
+        file->chunk = file->tail = growChunk(file->chunk, LINK_HEADER + offset, LINK_HEADER + offset + count);
     }
-
-    disk[indexBlock].type = INDEX_BLOCK_TYPE;
-    disk[indexBlock].content.data = 1;
-
-    for (int i = 0; i < MAX_BLOCK_PTRS; i++)
+    else if (offset % perBlock == 0)
     {
-        disk[indexBlock].content.blockPtrs[i] = NULL;
+        int block = getFreeBlock(cursor, INDEX_BLOCK_TYPE);
+        uint32_t next = newChunk(LINK_HEADER + perBlock);
+        uint32_t *entries = indexPoolChunk(&indexPool, next);
+        entries[NEXT_BLOCK] = INDEX_POOL_NONE;
+        entries[NEXT_CHUNK] = INDEX_POOL_NONE;
+        entries = indexPoolChunk(&indexPool, file->tail);
+        entries[NEXT_BLOCK] = block;
+        entries[NEXT_CHUNK] = next;
+        file->tail = next;
     }
+    return file->tail;
+}
 
-    int allocated = 0;
-    for (int i = 0; i < maxsize && allocated < blocks; i++)
+// Append 'count' data blocks to a file, searching for free blocks from
+// *cursor on. The caller has checked that they and their index blocks fit.
+static void addDataBlocks(struct FileEntry *file, int count, int *cursor)
+{
+    int linked = indexLevels == INDEX_LINKED;
+    int perBlock = linked ? ptrsPerBlock - 1 : ptrsPerBlock;
+    while (count > 0)
     {
-        if (disk[i].content.data == 0 && i != indexBlock)
+        int slot = file->blocks % perBlock;
+        int run = count < perBlock - slot ? count : perBlock - slot;
+        uint32_t leaf = linked ? linkedLeaf(file, cursor, run) : treeLeaf(file, cursor, run);
+
+        uint32_t *entries = indexPoolChunk(&indexPool, leaf) + (linked ? LINK_HEADER : 0);
+        for (int i = 0; i < run; i++)
         {
-            disk[i].type = DATA_BLOCK_TYPE;
-            disk[i].content.data = 1;
-            disk[indexBlock].content.blockPtrs[allocated] = &disk[i]; // Assign the block pointer to the index block
-            allocated++;
+            entries[slot + i] = getFreeBlock(cursor, DATA_BLOCK_TYPE);
         }
+        file->blocks += run;
+        count -= run;
     }
+}
 
-    if (allocated < blocks)
+static void walkTree(int block, uint32_t chunk, int level, long long count, size_t entryCount,
+                     void (*visitIndex)(int), void (*visitData)(int), int release)
+{
+    visitIndex(block);
+    uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+    if (level == 0)
     {
-        printf("\nNot enough free blocks\n");
-        disk[indexBlock].content.data = 0;
-        for (int i = 0; i < allocated; i++)
+        for (long long i = 0; i < count; i++)
         {
-            struct Block *blockPtr = disk[indexBlock].content.blockPtrs[i];
-            if (blockPtr != NULL)
-            {
-                blockPtr->content.data = 0;
-            }
+            visitData(entries[i]);
+        }
+    }
+    else
+    {
+        long long span = levelSpan(level);
+        for (int i = 0; (long long)i * span < count; i++)
+        {
+            long long rest = count - (long long)i * span;
+            walkTree(entries[i], entries[ptrsPerBlock + i], level - 1, rest < span ? rest : span,
+                     level > 1 ? 2 * ptrsPerBlock : ptrsPerBlock, visitIndex, visitData, release);
         }
+    }
+    if (release)
+        indexPoolFree(&indexPool, chunk, entryCount);
+}
+
+// Visit a file's index blocks and data blocks in order, each index block
+// before the blocks it lists. With 'release' set the index pool chunks are
+// freed on the way.
+static void walkFile(const struct FileEntry *file, void (*visitIndex)(int), void (*visitData)(int), int release)
+{
+    if (indexLevels != INDEX_LINKED)
+    {
+        walkTree(file->indexBlock, file->chunk, file->depth - 1, file->blocks,
+                 file->depth == 1 ? (size_t)file->blocks : 2 * (size_t)ptrsPerBlock, visitIndex, visitData, release);
         return;
     }
 
-    files[fileSlot].name = strdup(name);
-    files[fileSlot].indexBlock = indexBlock;
-    freeSpace -= (blocks + 1);
+    int perBlock = ptrsPerBlock - 1;
+    int remaining = file->blocks;
+    int block = file->indexBlock;
+    uint32_t chunk = file->chunk;
+    while (chunk != INDEX_POOL_NONE)
+    {
+        visitIndex(block);
+        uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+        int listed = remaining < perBlock ? remaining : perBlock;
+        for (int i = 0; i < listed; i++)
+        {
+            visitData(entries[LINK_HEADER + i]);
+        }
+        remaining -= listed;
 
-    printf("File inserted successfully\n");
+        uint32_t next = entries[NEXT_CHUNK];
+        block = entries[NEXT_BLOCK];
+        if (release)
+            indexPoolFree(&indexPool, chunk, chunk == file->chunk ? LINK_HEADER + (size_t)(file->blocks - remaining) : LINK_HEADER + (size_t)perBlock);
+        chunk = next;
+    }
 }
 
-void deleteFile(char *name)
+static int insertFile(const char *name, int blocks)
 {
-    int pos = searchFile(name);
-    if (pos == -1)
+    if (blocks <= 0)
     {
-        printf("\nFile not found\n");
-        return;
+        consolePrintf("\nInvalid number of blocks\n");
+        return -1;
     }
 
-    int indexBlock = files[pos].indexBlock;
-    struct Block *indexPtr = &disk[indexBlock];
+    if (blocks + indexBlocksFor(blocks) > freeSpace)
+    {
+        consolePrintf("\nFile size too big (need %d blocks, only %d available)\n", blocks + indexBlocksFor(blocks), freeSpace);
+        return -1;
+    }
 
-    // Free all the blocks pointed by the index block
-    for (int i = 0; i < MAX_BLOCK_PTRS; i++)
+    if (blocks > maxFileBlocks())
     {
-        if (indexPtr->content.blockPtrs[i] != NULL)
-        {
-            indexPtr->content.blockPtrs[i]->content.data = 0;
-            indexPtr->content.blockPtrs[i] = NULL;
-            freeSpace++;
-        }
+        consolePrintf("\nFile size too big (the index holds at most %lld blocks)\n", maxFileBlocks());
+        return -1;
+    }
+
+    if (searchFile(name) != -1)
+    {
+        consolePrintf("\nFile already exists\n");
+        return -1;
+    }
+
+    int fileSlot = getEmptySlot();
+    if (fileSlot == -1)
+    {
+        consolePrintf("\nNo free file slots\n");
+        return -1;
+    }
+
+    struct FileEntry *file = &files[fileSlot];
+    file->indexBlock = getFreeBlock(&nextFree, INDEX_BLOCK_TYPE);
+    file->blocks = 0;
+    file->depth = 1;
+    if (indexLevels == INDEX_LINKED)
+    {
+        file->chunk = newChunk(LINK_HEADER);
+        uint32_t *entries = indexPoolChunk(&indexPool, file->chunk);
+        entries[NEXT_BLOCK] = INDEX_POOL_NONE;
+        entries[NEXT_CHUNK] = INDEX_POOL_NONE;
+    }
+    else
+    {
+        file->chunk = newChunk(0);
+    }
+    file->tail = file->chunk;
+    addDataBlocks(file, blocks, &nextFree);
+
+    file->name = strdup(name);
+    directoryAdd(&directory, file->name);
+
+    consolePrintf("File inserted successfully\n");
+    return 0;
+}
+
+static int deleteFile(const char *name)
+{
+    int pos = searchFile(name);
+    if (pos == -1)
+    {
+        consolePrintf("\nFile not found\n");
+        return -1;
     }
 
-    disk[indexBlock].content.data = 0;
+    // Free all the index blocks and the data blocks they list
+    walkFile(&files[pos], releaseIndexBlock, releaseBlock, 1);
+    blocksScanned += files[pos].blocks;
+
+    directoryRemove(&directory, name);
     free(files[pos].name);
     files[pos].name = NULL;
     files[pos].indexBlock = -1;
-    freeSpace++;
+    files[pos].blocks = 0;
+    files[pos].chunk = INDEX_POOL_NONE;
 
-    printf("\nFile deleted successfully\n");
+    consolePrintf("\nFile deleted successfully\n");
+    return 0;
 }
 
-void displayFileInfo()
+static int appendFile(const char *name, int blocks)
+{
+    int pos = searchFile(name);
+    if (pos == -1)
+    {
+        consolePrintf("\nFile not found\n");
+        return -1;
+    }
+    if (blocks <= 0 || files[pos].blocks + (long long)blocks > maxFileBlocks())
+    {
+        consolePrintf("\nFile size too big (the index holds at most %lld blocks)\n", maxFileBlocks());
+        return -1;
+    }
+    int needed = blocks + indexBlocksFor(files[pos].blocks + blocks) - indexBlocksFor(files[pos].blocks);
+    if (needed > freeSpace)
+    {
+        consolePrintf("\nFile size too big (need %d blocks, only %d available)\n", needed, freeSpace);
+        return -1;
+    }
+
+    addDataBlocks(&files[pos], blocks, &nextFree);
+
+    consolePrintf("File extended successfully\n");
+    return 0;
+}
+
+// Fetch an index block, from the cache if it is there
+static void readIndexBlock(int block)
+{
+    blocksScanned++;
+    if (!lruTouch(&indexCache, block))
+        deviceRead(&device, block);
+}
+
+static void readDataBlock(int block)
+{
+    deviceRead(&device, block);
+}
+
+// Block holding block 'offset' of the file, found through one index block
+// per level (or along the list of linked index blocks). Returns -1 if there
+// is no such block.
+static int accessFile(const char *name, int offset)
+{
+    int pos = searchFile(name);
+    if (pos == -1 || offset < 0 || offset >= files[pos].blocks)
+    {
+        consolePrintf("Invalid file or block index!\n");
+        return -1;
+    }
+
+    int indexBlock = files[pos].indexBlock;
+    uint32_t chunk = files[pos].chunk;
+    int slot;
+    if (indexLevels == INDEX_LINKED)
+    {
+        int perBlock = ptrsPerBlock - 1;
+        for (int hops = offset / perBlock; hops > 0; hops--)
+        {
+            readIndexBlock(indexBlock);
+            uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+            indexBlock = entries[NEXT_BLOCK];
+            chunk = entries[NEXT_CHUNK];
+        }
+        slot = LINK_HEADER + offset % perBlock;
+    }
+    else
+    {
+        for (int level = files[pos].depth - 1; level > 0; level--)
+        {
+            readIndexBlock(indexBlock);
+            int child = (int)(offset / levelSpan(level) % ptrsPerBlock);
+            uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+            indexBlock = entries[child];
+            chunk = entries[ptrsPerBlock + child];
+        }
+        slot = offset % ptrsPerBlock;
+    }
+    readIndexBlock(indexBlock);
+    int block = indexPoolChunk(&indexPool, chunk)[slot];
+    deviceRead(&device, block);
+    return block;
+}
+
+static void displayFileInfo()
 {
     char name[20];
     printf("\nEnter file name: ");
@@ -195,28 +511,14 @@ void displayFileInfo()
         return;
     }
 
-    int indexBlock = files[pos].indexBlock;
-    struct Block *indexPtr = &disk[indexBlock];
-
-    int blockCount = 0;
+    int blockCount = files[pos].blocks;
     printf("\nFile: %s\n", files[pos].name);
 
-    // Sequential Access Time
-    clock_t start = clock();
-    for (int i = 0; i < MAX_BLOCK_PTRS; i++)
-    {
-        if (indexPtr->content.blockPtrs[i] != NULL)
-        {
-            struct timespec delay;
-            delay.tv_sec = 0;
-            delay.tv_nsec = 5 * 1000000L; // 5ms
-            nanosleep(&delay, NULL);
-            blockCount++;
-        }
-    }
-    clock_t end = clock();
-    double sequentialAccessTime = ((double)(end - start)) / CLOCKS_PER_SEC * 1000;
-    printf("Sequential Access Time: %.2f ms\n", sequentialAccessTime);
+    // Sequential Access Time: each index block, then every data block it lists
+    double start = device.clockMs;
+    walkFile(&files[pos], readIndexBlock, readDataBlock, 0);
+    double sequentialAccessTime = device.clockMs - start;
+    printf("Sequential Access Time: %.2f ms (%s)\n", sequentialAccessTime, deviceName(device.kind));
 
     // Random Access Time
     printf("Enter target block index (0 to %d): ", blockCount - 1);
@@ -229,43 +531,54 @@ void displayFileInfo()
         return;
     }
 
-    start = clock();
-    struct Block *targetBlock = indexPtr->content.blockPtrs[targetIndex];
-
-    struct timespec delay;
-    delay.tv_sec = 0;
-    delay.tv_nsec = 5 * 1000000L; // 5ms
-    nanosleep(&delay, NULL);
-
-    end = clock();
-    double randomAccessTime = ((double)(end - start)) / CLOCKS_PER_SEC * 1000;
+    start = device.clockMs;
+    accessFile(name, targetIndex);
+    double randomAccessTime = device.clockMs - start;
 
     printf("Random Access Time to Block %d: %.2f ms\n", targetIndex, randomAccessTime);
+    printf("Index block cache: %lld hits, %lld misses\n", indexCache.hits, indexCache.misses);
     printf("===============================================\n");
 }
 
-void displayDisk()
+static void displayDisk()
 {
     printf("\nDISK:\n");
+    if (diskSize > MAP_GRID_LIMIT)
+    {
+        // Too many blocks for a grid, list runs of equal status instead
+        int runStart = 0;
+        for (int i = 1; i <= diskSize; i++)
+        {
+            int used = bitmapTest(&usedBlocks, runStart);
+            if (i == diskSize || bitmapTest(&usedBlocks, i) != used ||
+                (used && blockTypes[i] != blockTypes[runStart]))
+            {
+                const char *label = !used ? "0" : blockTypes[runStart] == INDEX_BLOCK_TYPE ? "IB" : "DB";
+                printf("%d-%d\t%s\n", runStart, i - 1, label);
+                runStart = i;
+            }
+        }
+        return;
+    }
     printf("\t0\t1\t2\t3\t4\t5\t6\t7\t8\t9\n");
 
-    for (int i = 0; i < maxsize; i++)
+    for (int i = 0; i < diskSize; i++)
     {
         if (i % 10 == 0)
         {
             printf("\n%d\t", i);
         }
-        if (disk[i].content.data == 0)
+        if (!bitmapTest(&usedBlocks, i))
         {
             printf("0\t");
         }
         else
         {
-            if (disk[i].type == DATA_BLOCK_TYPE)
+            if (blockTypes[i] == DATA_BLOCK_TYPE)
             {
                 printf("DB\t");
             }
-            else if (disk[i].type == INDEX_BLOCK_TYPE)
+            else if (blockTypes[i] == INDEX_BLOCK_TYPE)
             {
                 printf("IB\t");
             }
@@ -274,41 +587,116 @@ void displayDisk()
     printf("\n");
 }
 
-void displayFiles()
+static void skipBlock(int block)
+{
+    (void)block;
+}
+
+static void printBlock(int block)
+{
+    printf("%d ", block);
+}
+
+static void displayFiles()
 {
     printf("\n========== FILES IN DISK ==========\n");
     printf("File Name      Index Block    Data Blocks\n");
     printf("----------------------------------------------------------\n");
 
-    for (int i = 0; i < MAX_FILES; i++)
+    for (int i = 0; i < maxFiles; i++)
     {
-        if (files[i].name != NULL && files[i].indexBlock >= 0 && files[i].indexBlock < maxsize)
+        if (files[i].name != NULL && files[i].indexBlock >= 0 && files[i].indexBlock < diskSize)
         {
             printf("%-15s %-13d ", files[i].name, files[i].indexBlock);
 
             // Count and display data blocks
             printf("[ ");
-            for (int j = 0; j < MAX_BLOCK_PTRS; j++)
-            {
-                struct Block *blockPtr = disk[files[i].indexBlock].content.blockPtrs[j];
-                if (blockPtr != NULL)
-                {
-                    printf("%ld ", blockPtr - disk); // Print block index by subtracting the base address of disk
-                }
-            }
+            walkFile(&files[i], skipBlock, printBlock, 0);
             printf("]\n");
         }
     }
     printf("==========================================================\n");
 }
 
-int main()
+// Memory used for block types, the index pool and cache, the free-space
+// bitmap and the file table
+static size_t metadataBytes()
+{
+    return diskSize * sizeof(unsigned char) + indexPoolBytes(&indexPool) + lruBytes(&indexCache) +
+           usedBlocks.wordCount * sizeof(uint64_t) + maxFiles * sizeof(struct FileEntry) + directoryBytes(&directory);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int indexedSetup(const struct SimOptions *options)
+{
+    diskSize = options->blockCount;
+    maxFiles = options->maxFiles;
+    ptrsPerBlock = options->blockSize / sizeof(int);
+    indexLevels = options->indexLevels;
+
+    init();
+    if (deviceInit(&device, options->deviceModel, diskSize, options->blockSize, options->cachePolicy,
+                   options->cacheBlocks) != 0 ||
+        deviceAttachImage(&device, options->diskImage) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+const char *indexedName()
+{
+    static const char *strategies[] = {"indexed-linked", "indexed", "indexed-2level", "indexed-3level"};
+    return strategies[indexLevels];
+}
+
+int indexedInsertFile(const char *name, int blocks)
+{
+    return insertFile(name, blocks);
+}
+
+int indexedDeleteFile(const char *name)
+{
+    return deleteFile(name);
+}
+
+int indexedAccessFile(const char *name, int offset)
+{
+    return accessFile(name, offset);
+}
+
+int indexedAppendFile(const char *name, int blocks)
+{
+    return appendFile(name, blocks);
+}
+
+size_t indexedMetadataBytes()
+{
+    return metadataBytes();
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
 {
     int option;
     char *name = malloc(20 * sizeof(char));
     int blocks;
 
-    init();
+    struct SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0 || indexedSetup(&options) != 0)
+    {
+        return 1;
+    }
+    struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+    if (options.workload != -1)
+    {
+        return runBenchmark(indexedName(), &handlers, metadataBytes, &options) == 0 ? 0 : 1;
+    }
+    if (options.traceFile != NULL)
+    {
+        return replayTrace(options.traceFile, &handlers) == 0 ? 0 : 1;
+    }
     printf("Indexed File Allocation Technique Simulation\n\n");
     printf("1. Insert a File\n");
     printf("2. Delete a File\n");
@@ -361,3 +749,4 @@ int main()
         }
     }
 }
+#endif
@@ -1,293 +1,918 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#define MAXSIZE 100
-#define MAX_FILES 30
+#include "bench.h"
+#include "bitmap.h"
+#include "console.h"
+#include "device.h"
+#include "directory.h"
+#include "extent-tree.h"
+#include "index-pool.h"
+#include "lru.h"
+#include "metrics.h"
+#include "options.h"
+#include "strategy.h"
+#include "trace.h"
+
 #define DIRECT_BLOCKS 10
-#define INDIRECT_BLOCKS 1
+#define INDIRECT_LEVELS 3 // Single, double and triple indirect trees
+#define INODE_BYTES 128   // Size of an inode in the on-disk inode table, as in ext2
 
 // Block Types
 #define DATA_BLOCK 0
 #define INODE_BLOCK 1
 #define INDIRECT_BLOCK 2
+#define EXTENT_BLOCK 3
 
 struct block
 {
-    int type; // 0: data, 1: inode, 2: indirect
-    int data; // 0: free, 1: used
+    unsigned char type; // 0: data, 1: inode, 2: indirect, 3: extent tree
 };
 
+// Indirect block contents live in the index pool. A single indirect block
+// lists ptrsPerBlock data blocks; a double or triple indirect block lists
+// (block, chunk) pairs for the indirect blocks below it. The block at the
+// top of each tree grows its chunk with the file, the rest are full size.
+// Whether an inode is in use is kept in the inode bitmap, and its file's
+// name in the directory.
 struct inode
 {
-    char *name;
     int size;                  // Size in blocks
     time_t created;            // Creation time
     int direct[DIRECT_BLOCKS]; // Direct block pointers
-    int indirect;              // Single indirect block pointer
-    int used;                  // 0: free, 1: used
+    int indirect[INDIRECT_LEVELS];           // Single, double and triple indirect block pointers
+    uint32_t indirectChunk[INDIRECT_LEVELS]; // Their pointer arrays in the index pool
+    struct ExtentTree *extents; // Extent mode: the block map, in place of the pointers above
+    int lastBlock;             // Last data block allocated; the file grows from just past it
+};
+
+// A block group, as in ext2: a slice of the disk with its own part of the
+// block bitmap (bits start .. start + blocks - 1 of usedBlocks, whole words
+// since groups start on 64-block boundaries), its own range of inodes and
+// their inode table blocks at the front.
+struct group
+{
+    int start;       // First block
+    int blocks;
+    int tableBlocks; // Inode table blocks at the start of the group
+    int firstInode;
+    int inodes;
+    int freeBlocks;
+    int freeInodes;
 };
 
 // Global variables
-struct block disk[MAXSIZE];
-struct inode inodes[MAX_FILES];
-int freeSpace = MAXSIZE;
+static int diskSize;     // Number of blocks, set from the command line
+static int maxFiles;     // Number of inodes
+static int blockSize;    // Bytes per block
+static int ptrsPerBlock; // Block numbers that fit in one indirect block
+static int extentMode;   // Map files with extent trees instead of block pointers
+static int growCursor;   // Where the free-block search of the current growFile resumes
+static int inodeCacheSize; // Inodes the inode cache holds, set from the command line
+static int blocksPerGroup; // Blocks one bitmap block covers; the last group takes the remainder
+static int inodesPerGroup;
+static int groupCount;
+static int lastGroup;    // Group of the last file created, where the next one tries to go
+static struct group *groups;
+static struct block *disk;
+static struct Bitmap usedBlocks; // One bit per block: 0 free, 1 used
+static struct IndexPool indexPool; // Pointer arrays of the indirect blocks
+static struct inode *inodes;       // The inode table
+static struct Bitmap inodeMap;     // One bit per inode: 0 free, 1 allocated
+static struct LruCache inodeCache; // Inodes whose table entry is in memory
+static char (*fileNames)[TRACE_NAME_MAX]; // Directory entries: the file name of each allocated inode
+static struct Directory directory; // Name -> inode number index over fileNames
+static int freeSpace;
+static int freeInodes;
+static long long fileReads;        // accessFile calls that read a block
+static long long readSeekDistance; // Blocks the head travelled during them
 
 // Function prototypes
-void init(void);
-int getFreeBlock(void);
-int getFreeInode(void);
-int searchFile(char *name);
-void insertFile(char *name, int blocks);
-void deleteFile(char *name);
-void displaySize(void);
-void displayDisk(void);
-void displayFiles(void);
+static void init(void);
+static int groupOf(int block);
+static void adjustFreeBlocks(int start, int count, int delta);
+static void claimBlocks(int start, int count, int type);
+static int getFreeBlock(int *cursor, int type);
+static int goalBlock(int inodeNum);
+static int findInodeGroup(int blocks);
+static int getFreeInode(int group);
+static int inodeBlock(int inodeNum);
+static struct inode *getInode(int inodeNum);
+static int searchFile(const char *name);
+static long long levelSpan(int height);
+static long long maxFileBlocks(void);
+static int indirectBlocksFor(long long size);
+static int blocksNeeded(int size, int blocks, const struct ExtentTree *extents);
+static uint32_t newChunk(size_t entries);
+static uint32_t growChunk(uint32_t chunk, size_t used, size_t entries);
+static uint32_t indirectLeaf(struct inode *node, int level, long long offset, int count, int *cursor);
+static int takeTreeBlock(void);
+static int growExtents(int inodeNum, int blocks);
+static int growFile(int inodeNum, int blocks);
+static int releaseBlocks(int inodeNum);
+static void walkIndirect(int block, uint32_t chunk, int height, long long count, size_t entryCount,
+                         void (*visitData)(int), int release);
+static void walkFileIndirect(int inodeNum, void (*visitTree)(int), void (*visitData)(int), int release);
+static void releaseDataBlock(int block);
+static void releaseExtent(const struct Extent *extent);
+static int insertFile(const char *name, int blocks);
+static int deleteFile(const char *name);
+static int appendFile(const char *name, int blocks);
+static void readMapBlock(int block);
+static int readFileBlock(struct inode *node, int offset);
+static int accessFile(const char *name, int offset);
+static void readFile(const char *name);
+static void printInodeStats(FILE *out);
+static void displaySize(void);
+static void displayDisk(void);
+static void printTree(int block);
+static void printBlock(int block);
+static void printExtent(const struct Extent *extent);
+static void displayFiles(void);
+static size_t metadataBytes(void);
 
-void init()
+static void init()
 {
-    // Initialize disk blocks
-    for (int i = 0; i < MAXSIZE; i++)
+    disk = calloc(diskSize, sizeof(struct block)); // Every block starts as DATA_BLOCK
+    inodes = malloc(sizeof(struct inode) * maxFiles);
+    fileNames = malloc(sizeof(*fileNames) * maxFiles);
+    if (disk == NULL || inodes == NULL || fileNames == NULL || bitmapInit(&usedBlocks, diskSize) != 0 ||
+        bitmapInit(&inodeMap, maxFiles) != 0 ||
+        lruInit(&inodeCache, inodeCacheSize < maxFiles ? inodeCacheSize : maxFiles) != 0 ||
+        indexPoolInit(&indexPool) != 0 || directoryInitIndex(&directory, maxFiles) != 0)
+    {
+        printf("Not enough memory for a %d-block disk\n", diskSize);
+        exit(1);
+    }
+
+    // One group per bitmap block's worth of blocks, the inodes split evenly
+    // between them, each group's inode table at its front
+    blocksPerGroup = 8 * blockSize;
+    groupCount = diskSize / blocksPerGroup > 0 ? diskSize / blocksPerGroup : 1;
+    inodesPerGroup = (maxFiles + groupCount - 1) / groupCount;
+    groups = malloc(sizeof(struct group) * groupCount);
+    if (groups == NULL)
+    {
+        printf("Not enough memory for a %d-block disk\n", diskSize);
+        exit(1);
+    }
+    freeSpace = diskSize;
+    freeInodes = maxFiles;
+    lastGroup = 0;
+    for (int g = 0; g < groupCount; g++)
     {
-        disk[i].type = DATA_BLOCK;
-        disk[i].data = 0;
+        struct group *group = &groups[g];
+        group->start = g * blocksPerGroup;
+        group->blocks = g < groupCount - 1 ? blocksPerGroup : diskSize - group->start;
+        group->firstInode = g * inodesPerGroup;
+        group->inodes = maxFiles - group->firstInode;
+        if (group->inodes > inodesPerGroup)
+            group->inodes = inodesPerGroup;
+        if (group->inodes < 0)
+            group->inodes = 0;
+        group->tableBlocks = (int)(((long long)group->inodes * INODE_BYTES + blockSize - 1) / blockSize);
+        if (group->tableBlocks >= group->blocks)
+        {
+            printf("A %d-inode table does not fit on a %d-block disk\n", maxFiles, diskSize);
+            exit(1);
+        }
+        group->freeBlocks = group->blocks;
+        group->freeInodes = group->inodes;
+        claimBlocks(group->start, group->tableBlocks, INODE_BLOCK);
     }
 
     // Initialize inodes
-    for (int i = 0; i < MAX_FILES; i++)
+    for (int i = 0; i < maxFiles; i++)
     {
-        inodes[i].name = NULL;
         inodes[i].size = 0;
-        inodes[i].used = 0;
-        inodes[i].indirect = -1;
         for (int j = 0; j < DIRECT_BLOCKS; j++)
         {
             inodes[i].direct[j] = -1;
         }
+        for (int j = 0; j < INDIRECT_LEVELS; j++)
+        {
+            inodes[i].indirect[j] = -1;
+            inodes[i].indirectChunk[j] = INDEX_POOL_NONE;
+        }
+        inodes[i].extents = NULL;
+        inodes[i].lastBlock = -1;
     }
 }
 
-int getFreeBlock()
+static int groupOf(int block)
 {
-    for (int i = 0; i < MAXSIZE; i++)
+    int group = block / blocksPerGroup;
+    return group < groupCount ? group : groupCount - 1;
+}
+
+// Add 'delta' free blocks for every block of the range to freeSpace and to
+// the free count of each group the range falls in
+static void adjustFreeBlocks(int start, int count, int delta)
+{
+    while (count > 0)
     {
-        if (disk[i].data == 0)
-        {
-            return i;
-        }
+        struct group *group = &groups[groupOf(start)];
+        int end = group->start + group->blocks;
+        int inGroup = start + count < end ? count : end - start;
+        group->freeBlocks += delta * inGroup;
+        freeSpace += delta * inGroup;
+        start += inGroup;
+        count -= inGroup;
     }
-    return -1;
 }
 
-int getFreeInode()
+// Mark the 'count' free blocks from 'start' used as 'type'
+static void claimBlocks(int start, int count, int type)
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    bitmapSetRange(&usedBlocks, start, count);
+    deviceStoreRun(&device, start, count);
+    for (int i = start; i < start + count; i++)
     {
-        if (!inodes[i].used)
-        {
-            return i;
-        }
+        disk[i].type = type;
     }
-    return -1;
+    adjustFreeBlocks(start, count, -1);
+}
+
+// Take the first free block at or after *cursor, the allocation goal, and
+// move the cursor past it, so allocating several blocks never restarts the
+// scan. Like ext2 the search runs on through the following groups and
+// wraps around the disk. Callers check freeSpace first, so it always
+// succeeds.
+static int getFreeBlock(int *cursor, int type)
+{
+    int block = bitmapFindClear(&usedBlocks, *cursor);
+    if (block == -1)
+        block = bitmapFindClear(&usedBlocks, 0);
+    bitmapSet(&usedBlocks, block);
+    disk[block].type = type;
+    deviceStoreRun(&device, block, 1);
+    groups[groupOf(block)].freeBlocks--;
+    freeSpace--;
+    *cursor = block + 1;
+    return block;
+}
+
+// Where the file's next block should go: just past its last block, or
+// after the inode table of its inode's group while it is empty
+static int goalBlock(int inodeNum)
+{
+    if (inodes[inodeNum].lastBlock != -1)
+        return inodes[inodeNum].lastBlock + 1;
+    struct group *group = &groups[inodeNum / inodesPerGroup];
+    return group->start + group->tableBlocks;
 }
 
-int searchFile(char *name)
+// Group for a new file's inode, after ext2's Orlov allocator. Every file
+// here sits in one directory, so as ext2 keeps a directory's files in its
+// group, a new file joins the last file's group while that group has a free
+// inode and room for the file. Otherwise it moves forward to the next group
+// Orlov would call good, one with at least the average number of free
+// inodes and free blocks, so neighbouring files stay close. Failing that
+// it takes the next group with room for the file, then any with a free
+// inode. Returns -1 if every inode is in use.
+static int findInodeGroup(int blocks)
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    struct group *last = &groups[lastGroup];
+    if (last->freeInodes > 0 && last->freeBlocks >= blocks)
+        return lastGroup;
+
+    int averageInodes = freeInodes / groupCount;
+    int averageBlocks = freeSpace / groupCount;
+    int roomy = -1, any = -1;
+    for (int i = 1; i <= groupCount; i++)
     {
-        if (inodes[i].used && inodes[i].name != NULL &&
-            strcmp(inodes[i].name, name) == 0)
-        {
-            return i;
-        }
+        int g = (lastGroup + i) % groupCount;
+        if (groups[g].freeInodes == 0)
+            continue;
+        if (groups[g].freeInodes >= averageInodes && groups[g].freeBlocks >= averageBlocks &&
+            groups[g].freeBlocks >= blocks)
+            return g;
+        if (roomy == -1 && groups[g].freeBlocks >= blocks)
+            roomy = g;
+        if (any == -1)
+            any = g;
     }
-    return -1;
+    return roomy != -1 ? roomy : any;
+}
+
+// First free inode of a group that has one
+static int getFreeInode(int group)
+{
+    return bitmapFindClear(&inodeMap, groups[group].firstInode);
 }
 
-void insertFile(char *name, int blocks)
+// Inode table block holding inode 'inodeNum'
+static int inodeBlock(int inodeNum)
 {
-    if (blocks > freeSpace)
+    struct group *group = &groups[inodeNum / inodesPerGroup];
+    return group->start + (int)((long long)(inodeNum - group->firstInode) * INODE_BYTES / blockSize);
+}
+
+// Inode 'inodeNum' read through the inode cache: a miss reads the inode
+// table block holding it from disk
+static struct inode *getInode(int inodeNum)
+{
+    if (!lruTouch(&inodeCache, inodeNum))
     {
-        printf("\nError: Not enough free space (need %d blocks)\n", blocks);
-        return;
+        blocksScanned++;
+        deviceRead(&device, inodeBlock(inodeNum));
     }
+    return &inodes[inodeNum];
+}
 
-    if (searchFile(name) != -1)
+static int searchFile(const char *name)
+{
+    return directoryLookup(&directory, name);
+}
+
+// Data blocks reachable through an indirect block 'height' levels above them
+static long long levelSpan(int height)
+{
+    long long span = 1;
+    while (height-- > 0)
     {
-        printf("\nError: File already exists\n");
-        return;
+        span *= ptrsPerBlock;
     }
+    return span;
+}
 
-    int inodeNum = getFreeInode();
-    if (inodeNum == -1)
+static long long maxFileBlocks()
+{
+    if (extentMode)
+        return INT_MAX;
+    long long blocks = DIRECT_BLOCKS;
+    for (int level = 0; level < INDIRECT_LEVELS && blocks < INT_MAX; level++)
     {
-        printf("\nError: No free inodes available\n");
-        return;
+        blocks += levelSpan(level + 1);
+    }
+    return blocks < INT_MAX ? blocks : INT_MAX;
+}
+
+// Indirect blocks a file of 'size' blocks needs
+static int indirectBlocksFor(long long size)
+{
+    long long rest = size - DIRECT_BLOCKS;
+    int count = 0;
+    for (int level = 0; level < INDIRECT_LEVELS && rest > 0; level++)
+    {
+        long long inTree = rest < levelSpan(level + 1) ? rest : levelSpan(level + 1);
+        for (int height = 1; height <= level + 1; height++)
+        {
+            long long span = levelSpan(height);
+            count += (int)((inTree + span - 1) / span);
+        }
+        rest -= inTree;
     }
+    return count;
+}
 
-    // Calculate needed blocks
-    int directNeeded = (blocks <= DIRECT_BLOCKS) ? blocks : DIRECT_BLOCKS;
-    int indirectNeeded = (blocks > DIRECT_BLOCKS) ? blocks - DIRECT_BLOCKS : 0;
-    int totalNeeded = blocks + (indirectNeeded > 0 ? 1 : 0); // +1 for indirect block
+// Blocks needed to grow a file from 'size' to 'size + blocks' blocks,
+// counting the indirect blocks this growth creates. In extent mode the tree
+// blocks depend on fragmentation, so a file's existing tree 'extents' is
+// charged the most the growth could add, one extent per block; a new file
+// (NULL) is charged its data blocks only, as growExtents checks as it goes
+// and insertFile releases a file it could not finish.
+static int blocksNeeded(int size, int blocks, const struct ExtentTree *extents)
+{
+    if (extentMode)
+        return extents != NULL ? blocks + extentTreeBlocksBound(extents, blocks) : blocks;
+    return blocks + indirectBlocksFor((long long)size + blocks) - indirectBlocksFor(size);
+}
 
-    if (totalNeeded > freeSpace)
+static uint32_t newChunk(size_t entries)
+{
+    uint32_t chunk = indexPoolAlloc(&indexPool, entries);
+    if (chunk == INDEX_POOL_NONE)
     {
-        printf("\nError: Not enough free space\n");
-        return;
+        printf("Not enough memory for the index pool\n");
+        exit(1);
+    }
+    return chunk;
+}
+
+static uint32_t growChunk(uint32_t chunk, size_t used, size_t entries)
+{
+    chunk = indexPoolGrow(&indexPool, chunk, used, entries);
+    if (chunk == INDEX_POOL_NONE)
+    {
+        printf("Not enough memory for the index pool\n");
+        exit(1);
+    }
+    return chunk;
+}
+
+// Pointer array of the single indirect block that will list block 'offset'
+// of indirect tree 'level' (0 single, 1 double, 2 triple), for a run of
+// 'count' blocks that fits in it. Indirect blocks are added as the run
+// reaches them.
+static uint32_t indirectLeaf(struct inode *node, int level, long long offset, int count, int *cursor)
+{
+    if (offset == 0)
+    {
+        node->indirect[level] = getFreeBlock(cursor, INDIRECT_BLOCK);
+        node->indirectChunk[level] = newChunk(0);
+    }
+    uint32_t chunk = node->indirectChunk[level];
+    if (level == 0)
+    {
+        node->indirectChunk[0] = growChunk(chunk, offset, offset + count);
+        return node->indirectChunk[0];
     }
 
-    // Allocate direct blocks
-    int allocated = 0;
-    for (int i = 0; i < directNeeded; i++)
+    for (int height = level + 1; height > 1; height--)
     {
-        int block = getFreeBlock();
-        if (block == -1)
+        long long span = levelSpan(height - 1); // Blocks under each child
+        int child = (int)(offset / span % ptrsPerBlock);
+        if (offset % span == 0)
         {
-            printf("\nError: Failed to allocate blocks\n");
-            // Cleanup
-            for (int j = 0; j < allocated; j++)
+            if (height == level + 1)
             {
-                disk[inodes[inodeNum].direct[j]].data = 0;
+                chunk = node->indirectChunk[level] = growChunk(chunk, 2 * child, 2 * child + 2);
             }
-            return;
+            int block = getFreeBlock(cursor, INDIRECT_BLOCK);
+            uint32_t below = newChunk(height > 2 ? 2 * ptrsPerBlock : ptrsPerBlock);
+            uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+            entries[2 * child] = block;
+            entries[2 * child + 1] = below;
         }
-        disk[block].data = 1;
-        disk[block].type = DATA_BLOCK;
-        inodes[inodeNum].direct[i] = block;
-        allocated++;
+        chunk = indexPoolChunk(&indexPool, chunk)[2 * child + 1];
     }
+    return chunk;
+}
 
-    // Allocate indirect blocks if needed
-    if (indirectNeeded > 0)
+static int takeTreeBlock()
+{
+    return getFreeBlock(&growCursor, EXTENT_BLOCK);
+}
+
+// Allocate 'blocks' more data blocks at the end of an extent-mapped file,
+// a whole free run at a time, leaving room for the tree blocks each new
+// extent needs. Returns -1 if the disk runs out part way; the inode's size
+// then covers what was allocated, which only insertFile, releasing the whole
+// file, lets happen.
+static int growExtents(int inodeNum, int blocks)
+{
+    struct inode *node = &inodes[inodeNum];
+    growCursor = goalBlock(inodeNum);
+    while (blocks > 0)
     {
-        // Allocate indirect block
-        int indirectBlock = getFreeBlock();
-        if (indirectBlock == -1)
+        int start = bitmapFindClear(&usedBlocks, growCursor);
+        if (start == -1)
+            start = bitmapFindClear(&usedBlocks, 0);
+        int want = blocks < EXTENT_MAX_LENGTH ? blocks : EXTENT_MAX_LENGTH;
+        int run = start != -1 ? bitmapFindSetBefore(&usedBlocks, start, start + want) - start : 0;
+
+        int needed = start != -1 ? extentTreeBlocksNeeded(node->extents, node->size, start, run) : 0;
+        if (run + needed > freeSpace)
+            run = freeSpace - needed;
+        if (start == -1 || run <= 0)
         {
-            printf("\nError: Failed to allocate indirect block\n");
-            // Cleanup
-            for (int i = 0; i < allocated; i++)
-            {
-                disk[inodes[inodeNum].direct[i]].data = 0;
-            }
-            return;
+            consolePrintf("\nError: Failed to allocate blocks\n");
+            return -1;
         }
-        disk[indirectBlock].data = 1;
-        disk[indirectBlock].type = INDIRECT_BLOCK;
-        inodes[inodeNum].indirect = indirectBlock;
 
-        // Allocate data blocks pointed to by indirect block
-        for (int i = 0; i < indirectNeeded; i++)
+        claimBlocks(start, run, DATA_BLOCK);
+        growCursor = start + run;
+        node->lastBlock = start + run - 1;
+        if (extentTreeAppend(node->extents, node->size, start, run, takeTreeBlock) != 0)
         {
-            int block = getFreeBlock();
-            if (block == -1)
-            {
-                printf("\nError: Failed to allocate blocks\n");
-                // Cleanup
-                for (int j = 0; j < allocated; j++)
-                {
-                    disk[inodes[inodeNum].direct[j]].data = 0;
-                }
-                disk[indirectBlock].data = 0;
-                return;
-            }
-            disk[block].data = 1;
-            disk[block].type = DATA_BLOCK;
-            // Store the block number in the indirect block's data
-            disk[indirectBlock].data = block;
-            allocated++;
+            printf("Not enough memory for the extent tree\n");
+            exit(1);
         }
+        node->size += run;
+        blocks -= run;
     }
+    return 0;
+}
 
-    // Setup inode
-    inodes[inodeNum].name = strdup(name);
-    inodes[inodeNum].size = blocks;
-    inodes[inodeNum].created = time(NULL);
-    inodes[inodeNum].used = 1;
-    freeSpace -= totalNeeded;
+// Allocate 'blocks' more data blocks at the end of the file, first into the
+// direct pointers and then through the single, double and triple indirect
+// trees. The caller has checked that they and their indirect blocks fit,
+// so only extent mode can fail (returning -1).
+static int growFile(int inodeNum, int blocks)
+{
+    if (extentMode)
+        return growExtents(inodeNum, blocks);
 
-    printf("\nFile '%s' inserted successfully\n", name);
-    printf("Inode: %d\n", inodeNum);
+    struct inode *node = &inodes[inodeNum];
+    int cursor = goalBlock(inodeNum);
+    while (blocks > 0 && node->size < DIRECT_BLOCKS)
+    {
+        node->direct[node->size++] = node->lastBlock = getFreeBlock(&cursor, DATA_BLOCK);
+        blocks--;
+    }
+
+    while (blocks > 0)
+    {
+        // Find the tree and the position in it that the next block goes to
+        long long offset = node->size - DIRECT_BLOCKS;
+        int level = 0;
+        while (offset >= levelSpan(level + 1))
+        {
+            offset -= levelSpan(level + 1);
+            level++;
+        }
+
+        int slot = (int)(offset % ptrsPerBlock);
+        int run = blocks < ptrsPerBlock - slot ? blocks : ptrsPerBlock - slot;
+        uint32_t leaf = indirectLeaf(node, level, offset, run, &cursor);
+        uint32_t *entries = indexPoolChunk(&indexPool, leaf);
+        for (int i = 0; i < run; i++)
+        {
+            entries[slot + i] = node->lastBlock = getFreeBlock(&cursor, DATA_BLOCK);
+        }
+        node->size += run;
+        blocks -= run;
+    }
+    return 0;
 }
 
-void deleteFile(char *name)
+// Visit the data blocks under an indirect block 'height' levels above them,
+// in file order. With 'release' set, the indirect blocks and their pool
+// chunks are freed on the way.
+static void walkIndirect(int block, uint32_t chunk, int height, long long count, size_t entryCount,
+                         void (*visitData)(int), int release)
 {
-    int inodeNum = searchFile(name);
-    if (inodeNum == -1)
+    uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+    if (height == 1)
     {
-        printf("\nError: File not found\n");
-        return;
+        for (long long i = 0; i < count; i++)
+        {
+            visitData(entries[i]);
+        }
     }
+    else
+    {
+        long long span = levelSpan(height - 1);
+        for (int i = 0; (long long)i * span < count; i++)
+        {
+            long long rest = count - (long long)i * span;
+            walkIndirect(entries[2 * i], entries[2 * i + 1], height - 1, rest < span ? rest : span,
+                         height > 2 ? 2 * ptrsPerBlock : ptrsPerBlock, visitData, release);
+        }
+    }
+    if (release)
+    {
+        indexPoolFree(&indexPool, chunk, entryCount);
+        disk[block].type = DATA_BLOCK;
+        releaseDataBlock(block);
+    }
+}
+
+// Visit the data blocks of every indirect tree of the inode, calling
+// 'visitTree' with each tree's top block first
+static void walkFileIndirect(int inodeNum, void (*visitTree)(int), void (*visitData)(int), int release)
+{
+    struct inode *node = &inodes[inodeNum];
+    long long rest = node->extents == NULL ? node->size - DIRECT_BLOCKS : 0; // Extent-mapped files have none
+    for (int level = 0; level < INDIRECT_LEVELS && rest > 0; level++)
+    {
+        long long inTree = rest < levelSpan(level + 1) ? rest : levelSpan(level + 1);
+        long long span = levelSpan(level); // Blocks under each entry of the top block
+        size_t topEntries = level == 0 ? (size_t)inTree : 2 * (size_t)((inTree + span - 1) / span);
+        if (visitTree != NULL)
+            visitTree(node->indirect[level]);
+        walkIndirect(node->indirect[level], node->indirectChunk[level], level + 1, inTree, topEntries,
+                     visitData, release);
+        if (release)
+        {
+            node->indirect[level] = -1;
+            node->indirectChunk[level] = INDEX_POOL_NONE;
+        }
+        rest -= inTree;
+    }
+}
+
+static void releaseDataBlock(int block)
+{
+    bitmapClear(&usedBlocks, block);
+    groups[groupOf(block)].freeBlocks++;
+    freeSpace++;
+    blocksScanned++;
+}
+
+static void releaseExtent(const struct Extent *extent)
+{
+    bitmapClearRange(&usedBlocks, extent->physical, extent->length);
+    adjustFreeBlocks(extent->physical, extent->length, 1);
+    blocksScanned++;
+}
 
-    int blocksFreed = 0;
+// Free every block the inode points to. Returns the number freed.
+static int releaseBlocks(int inodeNum)
+{
+    int before = freeSpace;
 
     // Free direct blocks
     for (int i = 0; i < DIRECT_BLOCKS && inodes[inodeNum].direct[i] != -1; i++)
     {
-        disk[inodes[inodeNum].direct[i]].data = 0;
-        disk[inodes[inodeNum].direct[i]].type = DATA_BLOCK;
+        releaseDataBlock(inodes[inodeNum].direct[i]);
         inodes[inodeNum].direct[i] = -1;
-        blocksFreed++;
     }
 
-    // Free indirect blocks
-    if (inodes[inodeNum].indirect != -1)
+    // Free the indirect trees and the data blocks they list
+    walkFileIndirect(inodeNum, NULL, releaseDataBlock, 1);
+
+    // Or the extents and the extent tree
+    if (inodes[inodeNum].extents != NULL)
+    {
+        extentTreeWalk(inodes[inodeNum].extents, releaseExtent);
+        extentTreeDestroy(inodes[inodeNum].extents, releaseDataBlock);
+        free(inodes[inodeNum].extents);
+        inodes[inodeNum].extents = NULL;
+    }
+
+    inodes[inodeNum].size = 0;
+    inodes[inodeNum].lastBlock = -1;
+    return freeSpace - before;
+}
+
+static int insertFile(const char *name, int blocks)
+{
+    if (blocks <= 0 || blocks > freeSpace)
+    {
+        consolePrintf("\nError: Not enough free space (need %d blocks)\n", blocks);
+        return -1;
+    }
+
+    if (blocks > maxFileBlocks())
+    {
+        consolePrintf("\nError: File too large (an inode addresses at most %lld blocks)\n", maxFileBlocks());
+        return -1;
+    }
+
+    if (strlen(name) >= TRACE_NAME_MAX)
+    {
+        consolePrintf("\nError: File name too long (at most %d characters)\n", TRACE_NAME_MAX - 1);
+        return -1;
+    }
+
+    if (searchFile(name) != -1)
+    {
+        consolePrintf("\nError: File already exists\n");
+        return -1;
+    }
+
+    int group = findInodeGroup(blocks);
+    if (group == -1)
+    {
+        consolePrintf("\nError: No free inodes available\n");
+        return -1;
+    }
+    int inodeNum = getFreeInode(group);
+
+    if (blocksNeeded(0, blocks, NULL) > freeSpace) // Including the indirect blocks
     {
-        // Free data blocks pointed to by indirect block
-        int indirectBlock = inodes[inodeNum].indirect;
-        for (int i = DIRECT_BLOCKS; i < inodes[inodeNum].size; i++)
+        consolePrintf("\nError: Not enough free space\n");
+        return -1;
+    }
+
+    struct inode *node = getInode(inodeNum);
+    node->size = 0;
+    if (extentMode)
+    {
+        node->extents = malloc(sizeof(struct ExtentTree));
+        if (node->extents == NULL || extentTreeInit(node->extents, blockSize) != 0)
         {
-            int dataBlock = disk[indirectBlock].data;
-            if (dataBlock != -1)
-            {
-                disk[dataBlock].data = 0;
-                disk[dataBlock].type = DATA_BLOCK;
-                blocksFreed++;
-            }
+            printf("Not enough memory for the extent tree\n");
+            exit(1);
         }
-        // Free the indirect block itself
-        disk[indirectBlock].data = 0;
-        disk[indirectBlock].type = DATA_BLOCK;
-        inodes[inodeNum].indirect = -1;
-        blocksFreed++;
+    }
+    if (growFile(inodeNum, blocks) != 0)
+    {
+        releaseBlocks(inodeNum); // Cleanup
+        return -1;
     }
 
+    // Setup inode and its directory entry
+    bitmapSet(&inodeMap, inodeNum);
+    groups[group].freeInodes--;
+    freeInodes--;
+    lastGroup = group;
+    node->created = time(NULL);
+    strcpy(fileNames[inodeNum], name);
+    directoryLink(&directory, fileNames[inodeNum], inodeNum);
+
+    consolePrintf("\nFile '%s' inserted successfully\n", name);
+    consolePrintf("Inode: %d\n", inodeNum);
+    return 0;
+}
+
+static int deleteFile(const char *name)
+{
+    int inodeNum = searchFile(name);
+    if (inodeNum == -1)
+    {
+        consolePrintf("\nError: File not found\n");
+        return -1;
+    }
+
+    getInode(inodeNum); // Its block pointers are needed to free the blocks
+    int blocksFreed = releaseBlocks(inodeNum);
+
     // Clear inode
-    free(inodes[inodeNum].name);
-    inodes[inodeNum].name = NULL;
-    inodes[inodeNum].size = 0;
-    inodes[inodeNum].used = 0;
-    freeSpace += blocksFreed;
+    directoryUnlink(&directory, name);
+    bitmapClear(&inodeMap, inodeNum);
+    groups[inodeNum / inodesPerGroup].freeInodes++;
+    freeInodes++;
+    lruRemove(&inodeCache, inodeNum);
+
+    consolePrintf("\nFile deleted successfully\n");
+    consolePrintf("Freed %d blocks\n", blocksFreed);
+    return 0;
+}
+
+static int appendFile(const char *name, int blocks)
+{
+    int inodeNum = searchFile(name);
+    if (inodeNum == -1)
+    {
+        consolePrintf("\nError: File not found\n");
+        return -1;
+    }
+    struct inode *node = getInode(inodeNum);
+    if (blocks <= 0 || node->size + (long long)blocks > maxFileBlocks() || blocksNeeded(node->size, blocks, node->extents) > freeSpace)
+    {
+        consolePrintf("\nError: Not enough free space (need %d blocks)\n", blocks);
+        return -1;
+    }
+
+    if (growFile(inodeNum, blocks) != 0)
+    {
+        return -1;
+    }
+    consolePrintf("\nFile '%s' extended to %d blocks\n", name, node->size);
+    return 0;
+}
+
+static void readMapBlock(int block)
+{
+    blocksScanned++;
+    deviceRead(&device, block);
+}
+
+// Read block 'offset' of the file and return where it is: a direct pointer
+// for the first DIRECT_BLOCKS blocks, otherwise one lookup per level of the
+// single, double or triple indirect tree it falls in. In extent mode it is
+// one lookup per level of the extent tree, each a bisection of one node.
+static int readFileBlock(struct inode *node, int offset)
+{
+    if (extentMode)
+    {
+        blocksScanned++; // The tree root in the inode
+        int dataBlock = extentTreeLookup(node->extents, offset, readMapBlock);
+        deviceRead(&device, dataBlock);
+        return dataBlock;
+    }
+
+    if (offset < DIRECT_BLOCKS)
+    {
+        blocksScanned++;
+        deviceRead(&device, node->direct[offset]);
+        return node->direct[offset];
+    }
+
+    long long rest = offset - DIRECT_BLOCKS;
+    int level = 0;
+    while (rest >= levelSpan(level + 1))
+    {
+        rest -= levelSpan(level + 1);
+        level++;
+    }
+
+    blocksScanned++; // The inode's indirect pointer
+    int block = node->indirect[level];
+    uint32_t chunk = node->indirectChunk[level];
+    for (int height = level + 1; height > 1; height--)
+    {
+        long long span = levelSpan(height - 1);
+        int child = (int)(rest / span % ptrsPerBlock);
+        blocksScanned++;
+        deviceRead(&device, block);
+        uint32_t *entries = indexPoolChunk(&indexPool, chunk);
+        block = entries[2 * child];
+        chunk = entries[2 * child + 1];
+    }
+    blocksScanned++;
+    deviceRead(&device, block);
+    int dataBlock = indexPoolChunk(&indexPool, chunk)[rest % ptrsPerBlock];
+    deviceRead(&device, dataBlock);
+    return dataBlock;
+}
+
+// Block holding block 'offset' of the file, read from the inode down.
+// Returns -1 if there is no such block.
+static int accessFile(const char *name, int offset)
+{
+    long long seekStart = device.seekDistance;
+    int inodeNum = searchFile(name);
+    struct inode *node = inodeNum != -1 ? getInode(inodeNum) : NULL;
+    if (node == NULL || offset < 0 || offset >= node->size)
+    {
+        consolePrintf("\nError: Invalid file or block index\n");
+        return -1;
+    }
+
+    int dataBlock = readFileBlock(node, offset);
+    fileReads++;
+    readSeekDistance += device.seekDistance - seekStart;
+    return dataBlock;
+}
+
+// Read the whole file a block at a time and show what it cost
+static void readFile(const char *name)
+{
+    int inodeNum = searchFile(name);
+    if (inodeNum == -1)
+    {
+        printf("\nError: File not found\n");
+        return;
+    }
 
-    printf("\nFile deleted successfully\n");
-    printf("Freed %d blocks\n", blocksFreed);
+    double start = device.clockMs;
+    long long seekStart = device.seekDistance;
+    for (int offset = 0; offset < inodes[inodeNum].size; offset++)
+    {
+        accessFile(name, offset);
+    }
+    printf("\nRead %d blocks of '%s' in %.2f ms (%s), the head travelled %lld blocks\n", inodes[inodeNum].size,
+           name, device.clockMs - start, deviceName(device.kind), device.seekDistance - seekStart);
+}
+
+static void printInodeStats(FILE *out)
+{
+    long long lookups = inodeCache.hits + inodeCache.misses;
+    fprintf(out, "Inode cache: %d of %d inodes, %lld hits, %lld misses (%.1f%% hit rate)\n", inodeCache.count,
+            inodeCache.capacity, inodeCache.hits, inodeCache.misses,
+            lookups > 0 ? 100.0 * inodeCache.hits / lookups : 0.0);
+    fprintf(out, "File reads: %lld, average seek distance %.1f blocks\n", fileReads,
+            fileReads > 0 ? (double)readSeekDistance / fileReads : 0.0);
 }
 
-void displaySize()
+static void displaySize()
 {
     printf("\n================== DISK INFO ==================\n");
-    printf("Total size: %d blocks\n", MAXSIZE);
-    printf("Free space: %d blocks\n", freeSpace);
-    printf("Used space: %d blocks\n", MAXSIZE - freeSpace);
+    printf("Total size: %d blocks\n", diskSize);
+    int usedCount = bitmapCountSet(&usedBlocks);
+    printf("Free space: %d blocks\n", diskSize - usedCount);
+    printf("Used space: %d blocks\n", usedCount);
+    printf("Inodes: %d of %d used\n", maxFiles - freeInodes, maxFiles);
+    printf("Block groups: %d, %d blocks (the last %d) and %d inodes each\n", groupCount, groups[0].blocks,
+           groups[groupCount - 1].blocks, inodesPerGroup);
+    printInodeStats(stdout);
+
+    // Block-map metadata, to compare extents with direct/indirect pointers
+    long long mapEntries = 0, mapBlocks = 0;
+    for (int i = 0; i < maxFiles; i++)
+    {
+        if (!bitmapTest(&inodeMap, i))
+            continue;
+        mapEntries += extentMode ? inodes[i].extents->extentCount : inodes[i].size;
+        mapBlocks += extentMode ? inodes[i].extents->nodeBlocks : indirectBlocksFor(inodes[i].size);
+    }
+    printf("Block map: %lld %s, %lld %s blocks\n", mapEntries, extentMode ? "extents" : "block pointers",
+           mapBlocks, extentMode ? "extent tree" : "indirect");
     printf("===============================================\n");
 }
 
-void displayDisk()
+static void displayDisk()
 {
     printf("\n=================== DISK MAP ===================\n");
+    if (diskSize > MAP_GRID_LIMIT)
+    {
+        // Too many blocks for a grid, list runs of equal status instead
+        int runStart = 0;
+        for (int i = 1; i <= diskSize; i++)
+        {
+            int used = bitmapTest(&usedBlocks, runStart);
+            if (i == diskSize || bitmapTest(&usedBlocks, i) != used ||
+                (used && disk[i].type != disk[runStart].type))
+            {
+                if (!used)
+                    printf("Blocks %d to %d: [--]\n", runStart, i - 1);
+                else
+                    printf("Blocks %d to %d: [%2d]\n", runStart, i - 1, disk[runStart].type);
+                runStart = i;
+            }
+        }
+        printf("===============================================\n");
+        return;
+    }
     printf("     ");
     for (int j = 0; j < 10; j++)
         printf("%4d ", j);
     printf("\n");
 
-    for (int i = 0; i < MAXSIZE; i++)
+    for (int i = 0; i < diskSize; i++)
     {
         if (i % 10 == 0)
         {
             printf("\n%3d  ", i);
         }
-        if (disk[i].data == 0)
+        if (!bitmapTest(&usedBlocks, i))
         {
             printf("[--] ");
         }
@@ -300,22 +925,37 @@ void displayDisk()
     printf("===============================================\n");
 }
 
-void displayFiles()
+static void printTree(int block)
+{
+    printf("| %d: ", block);
+}
+
+static void printBlock(int block)
+{
+    printf("%d ", block);
+}
+
+static void printExtent(const struct Extent *extent)
+{
+    printf("%d-%d ", extent->physical, extent->physical + extent->length - 1);
+}
+
+static void displayFiles()
 {
     printf("\n================ FILES IN DISK ================\n");
     printf("%-20s %-8s %-20s %-s\n", "File Name", "Size", "Created", "Blocks");
     printf("-----------------------------------------------\n");
 
-    for (int i = 0; i < MAX_FILES; i++)
+    for (int i = 0; i < maxFiles; i++)
     {
-        if (inodes[i].used && inodes[i].name != NULL)
+        if (bitmapTest(&inodeMap, i))
         {
             char timeStr[20];
             strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S",
                      localtime(&inodes[i].created));
 
             printf("%-20s %-8d %-20s [ ",
-                   inodes[i].name,
+                   fileNames[i],
                    inodes[i].size,
                    timeStr);
 
@@ -325,14 +965,11 @@ void displayFiles()
                 printf("%d ", inodes[i].direct[j]);
             }
 
-            // Print indirect blocks
-            if (inodes[i].indirect != -1)
+            // Print each indirect tree's top block, then the blocks it reaches
+            walkFileIndirect(i, printTree, printBlock, 0);
+            if (inodes[i].extents != NULL)
             {
-                printf("| %d: ", inodes[i].indirect);
-                for (int j = DIRECT_BLOCKS; j < inodes[i].size; j++)
-                {
-                    printf("%d ", disk[inodes[i].indirect].data);
-                }
+                extentTreeWalk(inodes[i].extents, printExtent);
             }
             printf("]\n");
         }
@@ -340,19 +977,100 @@ void displayFiles()
     printf("===============================================\n\n");
 }
 
-int main()
+// Memory used for block records, the indirect pointer arrays or extent
+// trees, the inode table, cache and bitmap, the directory, the group
+// descriptors and the free-space bitmap
+static size_t metadataBytes()
+{
+    return diskSize * sizeof(struct block) + indexPoolBytes(&indexPool) + extentTreeMemory +
+           usedBlocks.wordCount * sizeof(uint64_t) + maxFiles * sizeof(struct inode) +
+           inodeMap.wordCount * sizeof(uint64_t) + lruBytes(&inodeCache) + maxFiles * sizeof(*fileNames) +
+           directoryBytes(&directory) + groupCount * sizeof(struct group);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int inodeSetup(const struct SimOptions *options)
+{
+    diskSize = options->blockCount;
+    maxFiles = options->maxFiles;
+    blockSize = options->blockSize;
+    ptrsPerBlock = options->blockSize / sizeof(int);
+    extentMode = options->extentMode;
+    inodeCacheSize = options->inodeCache;
+
+    init();
+    if (deviceInit(&device, options->deviceModel, diskSize, options->blockSize, options->cachePolicy,
+                   options->cacheBlocks) != 0 ||
+        deviceAttachImage(&device, options->diskImage) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+const char *inodeName()
+{
+    return extentMode ? "inode-extent" : "inode";
+}
+
+int inodeInsertFile(const char *name, int blocks)
+{
+    return insertFile(name, blocks);
+}
+
+int inodeDeleteFile(const char *name)
+{
+    return deleteFile(name);
+}
+
+int inodeAccessFile(const char *name, int offset)
+{
+    return accessFile(name, offset);
+}
+
+int inodeAppendFile(const char *name, int blocks)
+{
+    return appendFile(name, blocks);
+}
+
+size_t inodeMetadataBytes()
+{
+    return metadataBytes();
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
 {
     int option;
     char *name = (char *)malloc(20 * sizeof(char));
     int blocks;
 
-    init();
+    struct SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0 || inodeSetup(&options) != 0)
+    {
+        return 1;
+    }
+    struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+    if (options.workload != -1)
+    {
+        int result = runBenchmark(inodeName(), &handlers, metadataBytes, &options);
+        printInodeStats(stderr); // Keeps the CSV on stdout clean
+        return result == 0 ? 0 : 1;
+    }
+    if (options.traceFile != NULL)
+    {
+        int result = replayTrace(options.traceFile, &handlers);
+        printInodeStats(stdout);
+        return result == 0 ? 0 : 1;
+    }
     printf("Inode-based File Allocation Technique\n\n");
     printf("1. Insert a File\n");
     printf("2. Delete a File\n");
     printf("3. Display the Disk\n");
     printf("4. Display All Files\n");
-    printf("5. Exit\n");
+    printf("5. Read a File\n");
+    printf("6. Exit\n");
 
     while (1)
     {
@@ -389,6 +1107,14 @@ int main()
             break;
 
         case 5:
+            printf("Enter file name to read: ");
+            getchar();
+            fgets(name, 20, stdin);
+            name[strcspn(name, "\n")] = '\0';
+            readFile(name);
+            break;
+
+        case 6:
             free(name);
             exit(0);
 
@@ -397,3 +1123,4 @@ int main()
         }
     }
 }
+#endif
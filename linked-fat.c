@@ -1,190 +1,431 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define maxsize 100
+
+#include "bench.h"
+#include "bitmap.h"
+#include "console.h"
+#include "device.h"
+#include "directory.h"
+#include "fat-cache.h"
+#include "fat-volume.h"
+#include "metrics.h"
+#include "options.h"
+#include "readahead.h"
+#include "strategy.h"
+#include "trace.h"
 
 // Function prototypes
-void init(void);
-int getEmptySlot(void);
-int searchFile(char *name);
-void insertFile(char *name, int blocks);
-void deleteFile(char *name);
-void displaySize(void);
-void displayDisk(void);
-void displayFiles(void);
-void displayFAT(void);
-
-// Block structure for visualization
-struct block
-{
-    int data; // 0=free, 1=occupied
-};
+static void init(void);
+static void saveFileEntry(int slot);
+static int getEmptySlot(void);
+static int searchFile(const char *name);
+static void buildFreeMap(void);
+static int findFreeCluster(int from);
+static int nextFreeCluster(void);
+static int allocateChain(int prev, int blocks, int *end);
+static int insertFile(const char *name, int blocks);
+static int deleteFile(const char *name);
+static int appendFile(const char *name, int blocks);
+static int accessFile(const char *name, int offset);
+static void displaySize(void);
+static void displayDisk(void);
+static void displayFiles(void);
+static void displayFAT(void);
+static size_t metadataBytes(void);
 
 // File entry structure
 struct fileEntry
 {
     char *name;
     int start;  // Starting block number
+    int end;    // Last block number, where appends are linked
     int blocks; // Number of blocks
+    struct FatCache cache; // Recently used runs of the chain
 };
 
 // Global variables
-struct block disk[maxsize]; // Disk blocks
-int FAT[maxsize];           // File Allocation Table (-1=EOF, -2=free, otherwise points to next block)
-int freeSpace = maxsize;
-struct fileEntry files[30];
-
-void init()
+static int diskSize;          // Number of blocks, set from the command line
+static int maxFiles;          // Number of file slots
+static struct Bitmap disk;    // Free-cluster bitmap (0=free, 1=occupied), built on first use
+static int freeMapBuilt;      // 1 once 'disk' mirrors the FAT
+static int useFreeMap;        // Search the bitmap instead of the FAT when allocating
+static struct FatVolume volume; // File Allocation Table, in memory or in a mapped image
+static struct FatFsInfo *info;  // Free count and next-free hint, stored with the FAT
+static struct fileEntry *files;
+static struct Directory directory; // Name -> file slot index and free-slot stack
+
+// Set up the file table and, unless an image is already open, an empty
+// in-memory FAT. Files stored in an image are loaded into the table.
+static void init()
 {
+    files = malloc(sizeof(struct fileEntry) * maxFiles);
+    if ((volume.map == NULL && fatVolumeCreateMemory(&volume, diskSize) != 0) || files == NULL ||
+        directoryInit(&directory, maxFiles) != 0)
+    {
+        printf("Not enough memory for a %d-block disk\n", diskSize);
+        exit(1);
+    }
+    info = volume.info;
+
     int i;
-    for (i = 0; i < 30; i++)
+    for (i = 0; i < maxFiles; i++)
     {
         files[i].name = NULL; // No files present
     }
-    for (i = 0; i < maxsize; i++)
+    for (i = 0; volume.directory != NULL && i < maxFiles; i++)
     {
-        disk[i].data = 0; // Disk is Empty
-        FAT[i] = -2;      // All blocks are free
+        struct FatImageEntry *entry = &volume.directory[i];
+        if (entry->name[0] == '\0')
+            continue;
+
+        // Slots are handed out lowest first, so entries only move down
+        int slot = getEmptySlot();
+        files[slot].name = strdup(entry->name);
+        directoryAdd(&directory, files[slot].name);
+        files[slot].start = entry->start;
+        files[slot].end = entry->end;
+        files[slot].blocks = entry->blocks;
+        fatCacheClear(&files[slot].cache);
+        if (slot != i)
+        {
+            saveFileEntry(slot);
+            entry->name[0] = '\0';
+        }
     }
 }
 
-int getEmptySlot()
+// Mirror a file-table slot into the image's directory
+static void saveFileEntry(int slot)
 {
-    int i;
-    for (i = 0; i < 30; i++)
+    if (volume.directory == NULL)
+        return;
+
+    struct FatImageEntry *entry = &volume.directory[slot];
+    if (files[slot].name == NULL)
     {
-        if (files[i].name == NULL)
-            return i;
+        entry->name[0] = '\0';
+        return;
     }
-    return -1;
+    snprintf(entry->name, FAT_NAME_MAX, "%s", files[slot].name);
+    entry->start = files[slot].start;
+    entry->end = files[slot].end;
+    entry->blocks = files[slot].blocks;
 }
 
-void insertFile(char *name, int blocks)
+static int getEmptySlot()
 {
-    if (blocks > freeSpace)
-    {
-        printf("\nFile size too big\n");
+    return directoryNextSlot(&directory);
+}
+
+// Build the free-cluster bitmap from the FAT the first time it is needed.
+// From then on every FAT update keeps it in step.
+static void buildFreeMap()
+{
+    if (freeMapBuilt)
         return;
+    if (bitmapInit(&disk, diskSize) != 0)
+    {
+        printf("Not enough memory for a %d-block bitmap\n", diskSize);
+        exit(1);
     }
-    if (searchFile(name) != -1)
+    for (int i = 0; i < diskSize; i++)
     {
-        printf("\nFile already exists\n");
-        return;
+        if (fatGet(&volume, i) != FAT_FREE)
+            bitmapSet(&disk, i);
+    }
+    freeMapBuilt = 1;
+}
+
+// First free cluster at or after 'from', or -1
+static int findFreeCluster(int from)
+{
+    if (useFreeMap)
+    {
+        buildFreeMap();
+        return bitmapFindClear(&disk, from); // Skips 64 occupied blocks at a time
     }
+    for (int i = from; i < diskSize; i++)
+    {
+        blocksScanned++;
+        if (fatGet(&volume, i) == FAT_FREE)
+            return i;
+    }
+    return -1;
+}
+
+// Free cluster at or after the FSInfo hint, wrapping around to block 0.
+// The caller has checked the free count, so one exists.
+static int nextFreeCluster()
+{
+    int i = findFreeCluster(info->nextFree);
+    if (i == -1)
+    {
+        i = findFreeCluster(0);
+    }
+    info->nextFree = i + 1 < diskSize ? i + 1 : 0;
+    return i;
+}
 
+// Take 'blocks' free blocks and chain them in the FAT after block 'prev'
+// (-1 for a new file). Returns the first block and stores the last in *end.
+// The search resumes where the previous allocation stopped, so its cost
+// follows the number of blocks taken rather than the volume size.
+static int allocateChain(int prev, int blocks, int *end)
+{
     int start = -1;
-    int prev = -1;
     int allocated = 0;
 
-    // Find and link free blocks
-    for (int i = 0; i < maxsize && allocated < blocks; i++)
+    while (allocated < blocks)
     {
-        if (FAT[i] == -2)
-        { // If block is free
-            if (start == -1)
-            {
-                start = i;
-            }
-            disk[i].data = 1; // Mark block as occupied
-
-            if (prev != -1)
-            {
-                FAT[prev] = i; // Link previous block to current
-            }
+        int i = nextFreeCluster();
+        if (start == -1)
+        {
+            start = i;
+        }
+        if (freeMapBuilt)
+        {
+            bitmapSet(&disk, i); // Mark block as occupied
+        }
 
-            FAT[i] = -1; // Mark as end of file for now
-            prev = i;
-            allocated++;
+        if (prev != -1)
+        {
+            fatSet(&volume, prev, i); // Link previous block to current
         }
+
+        fatSet(&volume, i, FAT_EOF); // Mark as end of file for now
+        deviceStoreRun(&device, i, 1);
+        prev = i;
+        allocated++;
     }
 
-    if (allocated == blocks)
+    info->freeCount -= blocks;
+    *end = prev;
+    return start;
+}
+
+static int insertFile(const char *name, int blocks)
+{
+    if (blocks <= 0)
     {
-        int slot = getEmptySlot();
-        files[slot].name = malloc(strlen(name) + 1);
-        strcpy(files[slot].name, name);
-        files[slot].start = start;
-        files[slot].blocks = blocks;
-        freeSpace -= blocks;
-        printf("File inserted successfully\n");
+        consolePrintf("\nInvalid number of blocks\n");
+        return -1;
+    }
+    if (blocks > info->freeCount)
+    {
+        consolePrintf("\nFile size too big\n");
+        return -1;
+    }
+    if (searchFile(name) != -1)
+    {
+        consolePrintf("\nFile already exists\n");
+        return -1;
+    }
+    if (volume.directory != NULL && strlen(name) >= FAT_NAME_MAX)
+    {
+        consolePrintf("\nFile name too long for the image\n");
+        return -1;
+    }
+    int slot = getEmptySlot();
+    if (slot == -1)
+    {
+        consolePrintf("\nNo free file slots\n");
+        return -1;
     }
+
+    files[slot].name = malloc(strlen(name) + 1);
+    strcpy(files[slot].name, name);
+    directoryAdd(&directory, files[slot].name);
+    files[slot].start = allocateChain(-1, blocks, &files[slot].end);
+    files[slot].blocks = blocks;
+    fatCacheClear(&files[slot].cache);
+    saveFileEntry(slot);
+    consolePrintf("File inserted successfully\n");
+    return 0;
 }
 
-void deleteFile(char *name)
+static int deleteFile(const char *name)
 {
     int pos = searchFile(name);
     if (pos == -1)
     {
-        printf("\nFile not found\n");
-        return;
+        consolePrintf("\nFile not found\n");
+        return -1;
     }
 
     int current = files[pos].start;
     int next;
 
     // Follow FAT chain and free blocks
-    while (current != -1)
+    while (current != FAT_EOF)
     {
-        next = FAT[current];
-        disk[current].data = 0; // Mark block as free
-        FAT[current] = -2;      // Mark block as free in FAT
+        next = fatGet(&volume, current);
+        if (freeMapBuilt)
+        {
+            bitmapClear(&disk, current); // Mark block as free
+        }
+        fatSet(&volume, current, FAT_FREE); // Mark block as free in FAT
         current = next;
+        blocksScanned++;
     }
 
-    freeSpace += files[pos].blocks;
+    info->freeCount += files[pos].blocks;
+    readaheadForget(&readahead, pos);
+    directoryRemove(&directory, name);
     free(files[pos].name);
     files[pos].name = NULL;
-    printf("File deleted successfully\n");
+    saveFileEntry(pos);
+    consolePrintf("File deleted successfully\n");
+    return 0;
 }
 
-int searchFile(char *name)
+static int appendFile(const char *name, int blocks)
 {
-    for (int i = 0; i < 30; i++)
+    int pos = searchFile(name);
+    if (pos == -1)
     {
-        if (files[i].name != NULL && strcmp(files[i].name, name) == 0)
-            return i;
+        consolePrintf("\nFile not found\n");
+        return -1;
     }
-    return -1;
+    if (blocks <= 0 || blocks > info->freeCount)
+    {
+        consolePrintf("\nFile size too big\n");
+        return -1;
+    }
+
+    allocateChain(files[pos].end, blocks, &files[pos].end);
+    files[pos].blocks += blocks;
+    saveFileEntry(pos);
+    consolePrintf("File extended successfully\n");
+    return 0;
 }
 
-void displaySize()
+// Readahead follows the FAT chain, held in memory, to the next cluster
+static int nextBlock(struct ReadaheadCursor *cursor)
 {
-    printf("\nFree space in disk = %d blocks\n", freeSpace);
+    int next = fatGet(&volume, cursor->block);
+    if (next == FAT_EOF)
+        return 0;
+    cursor->block = next;
+    return 1;
+}
+
+// Block holding block 'offset' of the file, found by following the FAT
+// chain from the nearest position in the file's chain cache (or its start).
+// The run that holds the target is cached for later seeks; with readahead, a
+// sequential reader steps on from the cluster it read last. Returns -1 if
+// there is no such block.
+static int accessFile(const char *name, int offset)
+{
+    int pos = searchFile(name);
+    if (pos == -1 || offset < 0 || offset >= files[pos].blocks)
+    {
+        consolePrintf("\nInvalid file or block index\n");
+        return -1;
+    }
+
+    struct ReadaheadCursor at = {0, 0, 0};
+    if (readaheadFollow(&readahead, pos, files[pos].start, offset, nextBlock, &at))
+    {
+        readaheadRead(&readahead, pos, files[pos].start, offset, &at, nextBlock);
+        return at.block;
+    }
+
+    // The FAT is held in memory, so only the target block is read from disk
+    int fileBlock = 0;
+    int current = files[pos].start;
+    if (!fatCacheLookup(&files[pos].cache, offset, &fileBlock, &current))
+    {
+        int runFileBlock = fileBlock;
+        int runDiskBlock = current;
+        while (fileBlock < offset)
+        {
+            int next = fatGet(&volume, current);
+            fileBlock++;
+            if (next != current + 1)
+            {
+                // A new run starts here
+                runFileBlock = fileBlock;
+                runDiskBlock = next;
+            }
+            current = next;
+            blocksScanned++;
+        }
+        fatCacheAdd(&files[pos].cache, runFileBlock, runDiskBlock, offset - runFileBlock);
+    }
+    at.block = current;
+    readaheadRead(&readahead, pos, files[pos].start, offset, &at, nextBlock);
+    return current;
 }
 
-void displayDisk()
+static int searchFile(const char *name)
+{
+    return directoryLookup(&directory, name);
+}
+
+static void displaySize()
+{
+    printf("\nFree space in disk = %d blocks (next free hint: %d)\n", info->freeCount, info->nextFree);
+    printf("FAT chain cache: %lld hits, %lld misses\n", fatCacheHits, fatCacheMisses);
+    if (volume.fatBits != 0)
+    {
+        printf("FAT%d image: %zu bytes of table\n", volume.fatBits, fatVolumeBytes(&volume));
+    }
+}
+
+static void displayDisk()
 {
     printf("\nDISK STATUS:\n");
+    buildFreeMap();
+    if (diskSize > MAP_GRID_LIMIT)
+    {
+        // Too many blocks for a grid, list runs of equal status instead
+        for (int runStart = 0; runStart < diskSize;)
+        {
+            int occupied = bitmapTest(&disk, runStart);
+            int runEnd = occupied ? bitmapFindClear(&disk, runStart) : bitmapFindSet(&disk, runStart);
+            if (runEnd == -1)
+                runEnd = diskSize;
+            printf("%d-%d\t%d\n", runStart, runEnd - 1, occupied);
+            runStart = runEnd;
+        }
+        return;
+    }
     printf("\n\t0\t1\t2\t3\t4\t5\t6\t7\t8\t9\n");
-    for (int i = 0; i < maxsize; i++)
+    for (int i = 0; i < diskSize; i++)
     {
         if (i % 10 == 0)
             printf("\n%d\t", i);
-        printf("%d\t", disk[i].data);
+        printf("%d\t", bitmapTest(&disk, i));
     }
     printf("\n");
 }
 
-void displayFAT()
+static void displayFAT()
 {
+    int shown = diskSize > MAP_GRID_LIMIT ? MAP_GRID_LIMIT : diskSize;
     printf("\nFILE ALLOCATION TABLE:\n");
     printf("\n\t0\t1\t2\t3\t4\t5\t6\t7\t8\t9\n");
-    for (int i = 0; i < maxsize; i++)
+    for (int i = 0; i < shown; i++)
     {
         if (i % 10 == 0)
             printf("\n%d\t", i);
-        printf("%d\t", FAT[i]);
+        printf("%d\t", fatGet(&volume, i));
     }
     printf("\n");
+    if (shown < diskSize)
+    {
+        printf("... %d more entries\n", diskSize - shown);
+    }
 }
 
-void displayFiles()
+static void displayFiles()
 {
     printf("\nFILES IN DISK:\n");
     printf("Name\tStart\tBlocks\tBlock Chain\n");
     printf("----------------------------------------\n");
 
-    for (int i = 0; i < 30; i++)
+    for (int i = 0; i < maxFiles; i++)
     {
         if (files[i].name != NULL)
         {
@@ -193,10 +434,10 @@ void displayFiles()
             // Print block chain
             int current = files[i].start;
             printf("%d", current);
-            while (FAT[current] != -1)
+            while (fatGet(&volume, current) != FAT_EOF)
             {
-                printf(" -> %d", FAT[current]);
-                current = FAT[current];
+                current = fatGet(&volume, current);
+                printf(" -> %d", current);
             }
             printf(" -> NULL\n");
         }
@@ -204,12 +445,105 @@ void displayFiles()
     printf("\n");
 }
 
-int main()
+// Memory used for the FAT, the free-cluster bitmap once built and the file table
+static size_t metadataBytes()
+{
+    return fatVolumeBytes(&volume) + disk.wordCount * sizeof(uint64_t) +
+           maxFiles * sizeof(struct fileEntry) + directoryBytes(&directory) + readaheadBytes(&readahead);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int linkedFatSetup(const struct SimOptions *options)
+{
+    diskSize = options->blockCount;
+    maxFiles = options->maxFiles;
+    int blockSize = options->blockSize;
+    useFreeMap = options->fatFreeMap;
+    if (options->fatImage != NULL)
+    {
+        // An existing image keeps the geometry it was formatted with,
+        // block size included, so the device is charged for its transfers
+        if (fatVolumeOpenImage(&volume, options->fatImage, diskSize, options->blockSize, maxFiles) != 0)
+        {
+            return -1;
+        }
+        diskSize = volume.blockCount;
+        maxFiles = volume.header->maxFiles;
+        blockSize = volume.header->blockSize;
+    }
+
+    init();
+    if (deviceInit(&device, options->deviceModel, diskSize, blockSize, options->cachePolicy,
+                   options->cacheBlocks) != 0 ||
+        deviceAttachImage(&device, options->diskImage) != 0 ||
+        readaheadInit(&readahead, maxFiles, options->readaheadWindow) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+const char *linkedFatName()
+{
+    return useFreeMap ? "linked-fat-bitmap" : "linked-fat";
+}
+
+int linkedFatInsertFile(const char *name, int blocks)
+{
+    return insertFile(name, blocks);
+}
+
+int linkedFatDeleteFile(const char *name)
+{
+    return deleteFile(name);
+}
+
+int linkedFatAccessFile(const char *name, int offset)
+{
+    return accessFile(name, offset);
+}
+
+int linkedFatAppendFile(const char *name, int blocks)
+{
+    return appendFile(name, blocks);
+}
+
+size_t linkedFatMetadataBytes()
+{
+    return metadataBytes();
+}
+
+// Flush a mapped image back to its file
+void linkedFatClose()
+{
+    fatVolumeClose(&volume);
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
 {
     char *name = (char *)malloc(20 * sizeof(char));
     int blocks, option;
 
-    init();
+    struct SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0 || linkedFatSetup(&options) != 0)
+    {
+        return 1;
+    }
+    struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+    if (options.workload != -1)
+    {
+        int status = runBenchmark(linkedFatName(), &handlers, metadataBytes, &options);
+        fatVolumeClose(&volume);
+        return status == 0 ? 0 : 1;
+    }
+    if (options.traceFile != NULL)
+    {
+        int status = replayTrace(options.traceFile, &handlers);
+        fatVolumeClose(&volume);
+        return status == 0 ? 0 : 1;
+    }
     printf("Linked File Allocation with FAT\n\n");
     printf("1. Insert a File\n");
     printf("2. Delete a File\n");
@@ -258,6 +592,7 @@ int main()
 
         case 6:
             free(name);
+            fatVolumeClose(&volume);
             exit(0);
 
         default:
@@ -266,3 +601,4 @@ int main()
     }
     return 0;
 }
+#endif
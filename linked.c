@@ -1,122 +1,243 @@
 #include <stdio.h>
 #include <stdlib.h> // for malloc, exit
-#include <string.h> // for strcpy, strcmp
-#include <time.h>	// for clock and nanosleep
-
-#define MAX_SIZE 100
-#define MAX_FILES 30
+#include <string.h> // for strcpy, strcspn
+
+#include "bench.h"
+#include "bitmap.h"
+#include "metrics.h"
+#include "console.h"
+#include "device.h"
+#include "directory.h"
+#include "options.h"
+#include "readahead.h"
+#include "strategy.h"
+#include "trace.h"
 
 // Function prototypes
-void initializeDisk(void);
-int findEmptyFileSlot(void);
-int findFileIndex(char *fileName);
-void insertFile(char *fileName, int blockCount);
-void deleteFile(char *fileName);
-void displayFreeSpace(void);
-void displayDiskStatus(void);
-void displayAllFiles(void);
-void displayFileDetails(void);
-
+static void initializeDisk(void);
+static int findEmptyFileSlot(void);
+static int findFileIndex(const char *fileName);
+static void allocateChain(int fileSlot, int blockCount);
+static void dropCheckpoints(int fileSlot);
+static void buildCheckpoints(int fileSlot);
+static int insertFile(const char *fileName, int blockCount);
+static int deleteFile(const char *fileName);
+static int appendFile(const char *fileName, int blockCount);
+static int accessFile(const char *fileName, int offset);
+static void displayFreeSpace(void);
+static void displayDiskStatus(void);
+static void displayAllFiles(void);
+static void displayFileDetails(void);
+static size_t checkpointBytes(void);
+static size_t metadataBytes(void);
+
+// A chain node. In block mode every node is one block; in extent mode a
+// node heads a run of contiguous blocks and only the head is linked.
 struct Block
 {
-	int isOccupied;
-	struct Block *next;
+	struct Block *next; // Head of the next run in the file
+	int length;			// Blocks in the run starting here
+};
+
+// In-memory shortcut into a chain: the node at file offset 'offset'
+struct Checkpoint
+{
+	int offset;
+	int block;
 };
 
 struct FileEntry
 {
 	char *fileName;
 	int startBlock;
-	int endBlock;
+	int endBlock; // Last block of the file
+	int lastRun;  // Head of the last run, where appends are linked
+	int extents;  // Runs in the chain
+	struct Checkpoint *checkpoints; // Every checkpointStride-th node, in file order
+	int checkpointCount;			// 0 until rebuilt after a change
 };
 
-struct Block disk[MAX_SIZE];
-int freeSpace = MAX_SIZE;
-struct FileEntry fileTable[MAX_FILES];
-
-void initializeDisk()
+static int diskSize; // Number of blocks, set from the command line
+static int maxFiles; // Number of file slots
+static struct Block *disk;
+static struct Bitmap usedBlocks; // One bit per block: 0 free, 1 occupied
+static int freeSpace;
+static int nextFree; // Where the next free-block search starts
+static struct FileEntry *fileTable;
+static struct Directory directory; // Name -> file slot index and free-slot stack
+static int extentMode;				// Chain runs of contiguous blocks instead of single blocks
+static int checkpointStride;		// Chain nodes between checkpoints, 0 to always walk from the start
+static long long checkpointReadsSaved; // Chain reads skipped by starting from a checkpoint
+
+static void initializeDisk()
 {
-	for (int fileSlot = 0; fileSlot < MAX_FILES; fileSlot++)
+	disk = malloc(sizeof(struct Block) * diskSize);
+	fileTable = malloc(sizeof(struct FileEntry) * maxFiles);
+	if (disk == NULL || fileTable == NULL || bitmapInit(&usedBlocks, diskSize) != 0 ||
+		directoryInit(&directory, maxFiles) != 0)
+	{
+		printf("Not enough memory for a %d-block disk.\n", diskSize);
+		exit(1);
+	}
+	freeSpace = diskSize;
+	nextFree = 0;
+
+	for (int fileSlot = 0; fileSlot < maxFiles; fileSlot++)
 	{
 		fileTable[fileSlot].fileName = NULL; // No files initially
+		fileTable[fileSlot].checkpoints = NULL;
+		fileTable[fileSlot].checkpointCount = 0;
 	}
-	for (int blockIndex = 0; blockIndex < MAX_SIZE; blockIndex++)
+	for (int blockIndex = 0; blockIndex < diskSize; blockIndex++)
 	{
-		disk[blockIndex].isOccupied = 0; // Disk is empty
-		disk[blockIndex].next = NULL;
+		disk[blockIndex].next = NULL; // Disk is empty
+		disk[blockIndex].length = 1;
 	}
 }
 
-int findEmptyFileSlot()
+static int findEmptyFileSlot()
 {
-	for (int fileSlot = 0; fileSlot < MAX_FILES; fileSlot++)
-	{
-		if (fileTable[fileSlot].fileName == NULL)
-		{
-			return fileSlot;
-		}
-	}
-	return -1;
+	return directoryNextSlot(&directory);
 }
 
-void insertFile(char *fileName, int blockCount)
+// Claim 'blockCount' free blocks and link them to the end of the file's
+// chain. In extent mode each free run found becomes one node, and a run that
+// starts right after the file's last block extends the last node instead.
+static void allocateChain(int fileSlot, int blockCount)
 {
-	if (blockCount > freeSpace)
-	{
-		printf("\nError: Not enough free space to insert the file.\n");
-		return;
-	}
-	if (findFileIndex(fileName) != -1)
-	{
-		printf("\nError: File with the same name already exists.\n");
-		return;
-	}
-
-	int startBlock = -1;
-	int allocatedBlocks = 0;
-	int previousBlock = -1;
+	struct FileEntry *file = &fileTable[fileSlot];
+	int remaining = blockCount;
 
-	for (int blockIndex = 0; blockIndex < MAX_SIZE; blockIndex++)
+	// Claim free blocks from where the last allocation stopped, wrapping
+	// around to block 0 and skipping 64 occupied blocks at a time
+	int blockIndex = nextFree - 1;
+	while (remaining > 0)
 	{
-		if (disk[blockIndex].isOccupied == 0)
+		blockIndex = bitmapFindClear(&usedBlocks, blockIndex + 1);
+		if (blockIndex == -1)
 		{
-			if (startBlock == -1)
+			blockIndex = bitmapFindClear(&usedBlocks, 0);
+		}
+		int runLength = 1;
+		if (extentMode)
+		{
+			int runEnd = bitmapFindSet(&usedBlocks, blockIndex);
+			if (runEnd == -1)
 			{
-				startBlock = blockIndex;
+				runEnd = diskSize;
 			}
-			disk[blockIndex].isOccupied = 1;
+			runLength = runEnd - blockIndex < remaining ? runEnd - blockIndex : remaining;
+		}
+		bitmapSetRange(&usedBlocks, blockIndex, runLength);
+		deviceStoreRun(&device, blockIndex, runLength);
 
-			if (previousBlock != -1)
+		if (extentMode && file->lastRun != -1 && file->endBlock + 1 == blockIndex)
+		{
+			disk[file->lastRun].length += runLength;
+		}
+		else
+		{
+			disk[blockIndex].next = NULL;
+			disk[blockIndex].length = runLength;
+			if (file->lastRun != -1)
+			{
+				disk[file->lastRun].next = &disk[blockIndex];
+			}
+			else
 			{
-				disk[previousBlock].next = &disk[blockIndex];
+				file->startBlock = blockIndex;
 			}
-			allocatedBlocks++;
-			previousBlock = blockIndex;
+			file->lastRun = blockIndex;
+			file->extents++;
 		}
-		if (allocatedBlocks == blockCount)
+		file->endBlock = blockIndex + runLength - 1;
+		remaining -= runLength;
+		blockIndex = file->endBlock;
+	}
+	nextFree = blockIndex + 1 < diskSize ? blockIndex + 1 : 0;
+	freeSpace -= blockCount;
+}
+
+static void dropCheckpoints(int fileSlot)
+{
+	free(fileTable[fileSlot].checkpoints);
+	fileTable[fileSlot].checkpoints = NULL;
+	fileTable[fileSlot].checkpointCount = 0;
+}
+
+// Walk the chain once and remember every checkpointStride-th node. The walk
+// reads each node head, the same cost as one seek without checkpoints.
+static void buildCheckpoints(int fileSlot)
+{
+	struct FileEntry *file = &fileTable[fileSlot];
+	int capacity = (file->extents + checkpointStride - 1) / checkpointStride;
+	file->checkpoints = malloc(sizeof(struct Checkpoint) * capacity);
+	if (file->checkpoints == NULL)
+	{
+		return; // Lookups fall back to walking from the start
+	}
+
+	struct Block *currentBlock = &disk[file->startBlock];
+	int offset = 0;
+	for (int node = 0; currentBlock != NULL; node++)
+	{
+		if (node % checkpointStride == 0)
 		{
-			disk[blockIndex].next = NULL;
-			break;
+			file->checkpoints[file->checkpointCount].offset = offset;
+			file->checkpoints[file->checkpointCount].block = (int)(currentBlock - disk);
+			file->checkpointCount++;
 		}
+		deviceRead(&device, (int)(currentBlock - disk));
+		offset += currentBlock->length;
+		currentBlock = currentBlock->next;
+		blocksScanned++;
+	}
+}
+
+static int insertFile(const char *fileName, int blockCount)
+{
+	if (blockCount <= 0)
+	{
+		consolePrintf("\nError: Invalid number of blocks.\n");
+		return -1;
+	}
+	if (blockCount > freeSpace)
+	{
+		consolePrintf("\nError: Not enough free space to insert the file.\n");
+		return -1;
+	}
+	if (findFileIndex(fileName) != -1)
+	{
+		consolePrintf("\nError: File with the same name already exists.\n");
+		return -1;
 	}
 
 	int fileSlot = findEmptyFileSlot();
+	if (fileSlot == -1)
+	{
+		consolePrintf("\nError: No available file slot.\n");
+		return -1;
+	}
+
+	fileTable[fileSlot].lastRun = -1;
+	fileTable[fileSlot].extents = 0;
+	allocateChain(fileSlot, blockCount);
+
 	fileTable[fileSlot].fileName = malloc(strlen(fileName) + 1);
 	strcpy(fileTable[fileSlot].fileName, fileName);
-	fileTable[fileSlot].startBlock = startBlock;
-	fileTable[fileSlot].endBlock = previousBlock;
-	freeSpace -= blockCount;
+	directoryAdd(&directory, fileTable[fileSlot].fileName);
 
-	printf("\nFile '%s' inserted successfully.\n", fileName);
+	consolePrintf("\nFile '%s' inserted successfully.\n", fileName);
+	return 0;
 }
 
-void deleteFile(char *fileName)
+static int deleteFile(const char *fileName)
 {
 	int fileIndex = findFileIndex(fileName);
 	if (fileIndex == -1)
 	{
-		printf("\nError: File not found.\n");
-		return;
+		consolePrintf("\nError: File not found.\n");
+		return -1;
 	}
 
 	struct Block *currentBlock = &disk[fileTable[fileIndex].startBlock];
@@ -124,37 +245,176 @@ void deleteFile(char *fileName)
 
 	while (currentBlock != NULL)
 	{
-		currentBlock->isOccupied = 0;
-		releasedBlocks++;
+		bitmapClearRange(&usedBlocks, (int)(currentBlock - disk), currentBlock->length);
+		releasedBlocks += currentBlock->length;
+		blocksScanned++;
 		currentBlock = currentBlock->next;
 	}
 
 	freeSpace += releasedBlocks;
+	dropCheckpoints(fileIndex);
+	readaheadForget(&readahead, fileIndex);
+	directoryRemove(&directory, fileName);
 	free(fileTable[fileIndex].fileName);
 	fileTable[fileIndex].fileName = NULL;
 
-	printf("\nFile '%s' deleted successfully.\n", fileName);
+	consolePrintf("\nFile '%s' deleted successfully.\n", fileName);
+	return 0;
 }
 
-int findFileIndex(char *fileName)
+static int appendFile(const char *fileName, int blockCount)
 {
-	for (int fileSlot = 0; fileSlot < MAX_FILES; fileSlot++)
+	int fileIndex = findFileIndex(fileName);
+	if (fileIndex == -1)
 	{
-		if (fileTable[fileSlot].fileName != NULL && strcmp(fileTable[fileSlot].fileName, fileName) == 0)
+		consolePrintf("\nError: File not found.\n");
+		return -1;
+	}
+	if (blockCount <= 0 || blockCount > freeSpace)
+	{
+		consolePrintf("\nError: Not enough free space to extend the file.\n");
+		return -1;
+	}
+
+	allocateChain(fileIndex, blockCount);
+	dropCheckpoints(fileIndex); // Rebuilt on the next lookup
+
+	consolePrintf("\nFile '%s' extended by %d blocks.\n", fileName, blockCount);
+	return 0;
+}
+
+// Readahead moves on through the run, then follows the chain to the next
+static int nextBlock(struct ReadaheadCursor *cursor)
+{
+	if (cursor->runLeft > 0)
+	{
+		cursor->block++;
+		cursor->runLeft--;
+		return 1;
+	}
+	struct Block *next = disk[cursor->run].next;
+	if (next == NULL)
+	{
+		return 0;
+	}
+	cursor->run = (int)(next - disk);
+	cursor->block = cursor->run;
+	cursor->runLeft = next->length - 1;
+	return 1;
+}
+
+// Physical block holding block 'offset' of the file, found by following
+// the chain from the nearest checkpoint at or before it (the first block
+// without checkpoints). Each node skipped costs a read of its head, where the
+// next pointer lives; with readahead, a sequential reader instead steps on
+// from the block it read last. Returns -1 if there is no such block.
+static int accessFile(const char *fileName, int offset)
+{
+	int fileIndex = findFileIndex(fileName);
+	if (fileIndex == -1 || offset < 0)
+	{
+		consolePrintf("Error: Invalid file or block index.\n");
+		return -1;
+	}
+
+	struct ReadaheadCursor at;
+	if (readaheadFollow(&readahead, fileIndex, fileTable[fileIndex].startBlock, offset, nextBlock, &at))
+	{
+		readaheadRead(&readahead, fileIndex, fileTable[fileIndex].startBlock, offset, &at, nextBlock);
+		return at.block;
+	}
+
+	int fileOffset = offset;
+	struct Block *currentBlock = &disk[fileTable[fileIndex].startBlock];
+	if (checkpointStride > 0)
+	{
+		struct FileEntry *file = &fileTable[fileIndex];
+		if (file->checkpointCount == 0)
 		{
-			return fileSlot;
+			buildCheckpoints(fileIndex);
 		}
+		if (file->checkpointCount > 0)
+		{
+			// Binary search for the last checkpoint at or before the offset
+			int low = 0, high = file->checkpointCount - 1;
+			while (low < high)
+			{
+				int middle = (low + high + 1) / 2;
+				if (file->checkpoints[middle].offset <= offset)
+					low = middle;
+				else
+					high = middle - 1;
+				blocksScanned++;
+			}
+			currentBlock = &disk[file->checkpoints[low].block];
+			offset -= file->checkpoints[low].offset;
+			checkpointReadsSaved += (long long)low * checkpointStride;
+		}
+	}
+	while (currentBlock != NULL && offset >= currentBlock->length)
+	{
+		deviceRead(&device, (int)(currentBlock - disk));
+		offset -= currentBlock->length;
+		currentBlock = currentBlock->next;
+		blocksScanned++;
 	}
-	return -1;
+	if (currentBlock == NULL)
+	{
+		consolePrintf("Error: Invalid file or block index.\n");
+		return -1;
+	}
+	at.run = (int)(currentBlock - disk);
+	at.block = at.run + offset;
+	at.runLeft = currentBlock->length - offset - 1;
+	readaheadRead(&readahead, fileIndex, fileTable[fileIndex].startBlock, fileOffset, &at, nextBlock);
+	return at.block;
 }
 
-void displayFreeSpace()
+static int findFileIndex(const char *fileName)
 {
-	printf("Free space in disk: %d blocks\n", freeSpace);
+	return directoryLookup(&directory, fileName);
 }
 
-void displayDiskStatus()
+// Memory held by the checkpoint arrays that are currently built
+static size_t checkpointBytes()
 {
+	size_t bytes = 0;
+	for (int fileSlot = 0; fileSlot < maxFiles; fileSlot++)
+	{
+		bytes += fileTable[fileSlot].checkpointCount * sizeof(struct Checkpoint);
+	}
+	return bytes;
+}
+
+static void displayFreeSpace()
+{
+	printf("Free space in disk: %d blocks\n", diskSize - bitmapCountSet(&usedBlocks));
+	if (checkpointStride > 0)
+	{
+		printf("Checkpoints: %zu bytes, %lld chain reads saved\n", checkpointBytes(), checkpointReadsSaved);
+	}
+}
+
+static void displayDiskStatus()
+{
+	if (diskSize > MAP_GRID_LIMIT)
+	{
+		// Too many blocks for a grid, list runs of equal status instead
+		printf("\nDisk Status:\n\n");
+		for (int runStart = 0; runStart < diskSize;)
+		{
+			int occupied = bitmapTest(&usedBlocks, runStart);
+			int runEnd = occupied ? bitmapFindClear(&usedBlocks, runStart) : bitmapFindSet(&usedBlocks, runStart);
+			if (runEnd == -1)
+			{
+				runEnd = diskSize;
+			}
+			printf("%d-%d\t%d\n", runStart, runEnd - 1, occupied);
+			runStart = runEnd;
+		}
+		return;
+	}
+
 	printf("\nDisk Status:\n\n\t");
 	for (int blockIndex = 0; blockIndex < 10; blockIndex++)
 	{
@@ -162,32 +422,39 @@ void displayDiskStatus()
 	}
 	printf("\n");
 
-	for (int blockIndex = 0; blockIndex < MAX_SIZE; blockIndex++)
+	for (int blockIndex = 0; blockIndex < diskSize; blockIndex++)
 	{
 		if (blockIndex % 10 == 0)
 		{
 			printf("\n%d\t", blockIndex);
 		}
-		printf("%d\t", disk[blockIndex].isOccupied);
+		printf("%d\t", bitmapTest(&usedBlocks, blockIndex));
 	}
 	printf("\n");
 }
 
-void displayAllFiles()
+static void displayAllFiles()
 {
 	printf("\nFiles on disk:\n");
 	printf("Name\tStart\tEnd\n\n");
-	for (int fileSlot = 0; fileSlot < MAX_FILES; fileSlot++)
+	for (int fileSlot = 0; fileSlot < maxFiles; fileSlot++)
 	{
 		if (fileTable[fileSlot].fileName != NULL)
 		{
 			printf("%s\t%4d\t%3d\n", fileTable[fileSlot].fileName, fileTable[fileSlot].startBlock, fileTable[fileSlot].endBlock);
-			printf("Blocks: %d -> ", fileTable[fileSlot].startBlock);
+			if (extentMode)
+				printf("Extents (%d): ", fileTable[fileSlot].extents);
+			else
+				printf("Blocks: ");
 
-			struct Block *currentBlock = disk[fileTable[fileSlot].startBlock].next;
+			struct Block *currentBlock = &disk[fileTable[fileSlot].startBlock];
 			while (currentBlock != NULL)
 			{
-				printf("%ld -> ", (long int)(currentBlock - disk));
+				long int head = (long int)(currentBlock - disk);
+				if (currentBlock->length > 1)
+					printf("%ld-%ld -> ", head, head + currentBlock->length - 1);
+				else
+					printf("%ld -> ", head);
 				currentBlock = currentBlock->next;
 			}
 			printf("NULL\n");
@@ -195,7 +462,7 @@ void displayAllFiles()
 	}
 }
 
-void displayFileDetails()
+static void displayFileDetails()
 {
 	char fileName[20];
 	printf("\nEnter file name: ");
@@ -214,19 +481,16 @@ void displayFileDetails()
 	int blockCount = 0;
 	printf("\nFile: %s\n", fileTable[fileIndex].fileName);
 
-	// Sequential Access Time
-	clock_t startTime = clock();
+	// Sequential Access Time: read the chain in order, one run at a time
+	double startTime = device.clockMs;
 	while (currentBlock != NULL)
 	{
+		deviceReadRun(&device, (int)(currentBlock - disk), currentBlock->length);
+		blockCount += currentBlock->length;
 		currentBlock = currentBlock->next;
-		blockCount++;
-
-		struct timespec delay = {0, 5 * 1000000L}; // 5ms
-		nanosleep(&delay, NULL);
 	}
-	clock_t endTime = clock();
-	double sequentialTime = ((double)(endTime - startTime)) / CLOCKS_PER_SEC * 1000;
-	printf("Sequential Access Time: %.2f ms\n", sequentialTime);
+	double sequentialTime = device.clockMs - startTime;
+	printf("Sequential Access Time: %.2f ms (%s)\n", sequentialTime, deviceName(device.kind));
 
 	// Random Access Time
 	printf("Enter target block index (0 to %d): ", blockCount - 1);
@@ -239,30 +503,101 @@ void displayFileDetails()
 		return;
 	}
 
-	currentBlock = &disk[fileTable[fileIndex].startBlock];
-	startTime = clock();
-	for (int index = 0; index <= targetIndex; index++)
+	startTime = device.clockMs;
+	accessFile(fileName, targetIndex);
+	double randomTime = device.clockMs - startTime;
+
+	printf("Random Access Time to Block %d: %.2f ms\n", targetIndex, randomTime);
+	if (checkpointStride > 0)
 	{
-		currentBlock = currentBlock->next;
+		printf("Checkpoints: %d entries (%zu bytes) for %d chain nodes\n", fileTable[fileIndex].checkpointCount,
+			   fileTable[fileIndex].checkpointCount * sizeof(struct Checkpoint), fileTable[fileIndex].extents);
+	}
+	printf("===============================================\n");
+}
 
-		struct timespec delay = {0, 5 * 1000000L}; // 5ms
-		nanosleep(&delay, NULL);
+// Memory used for the chain links, free-space bitmap and file table
+static size_t metadataBytes()
+{
+	return diskSize * sizeof(struct Block) + usedBlocks.wordCount * sizeof(uint64_t) +
+		   maxFiles * sizeof(struct FileEntry) + directoryBytes(&directory) + checkpointBytes() +
+		   readaheadBytes(&readahead);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int linkedSetup(const struct SimOptions *options)
+{
+	diskSize = options->blockCount;
+	maxFiles = options->maxFiles;
+	extentMode = options->extentMode;
+	checkpointStride = options->checkpointStride;
+	initializeDisk();
+	if (deviceInit(&device, options->deviceModel, diskSize, options->blockSize, options->cachePolicy,
+	               options->cacheBlocks) != 0 ||
+		deviceAttachImage(&device, options->diskImage) != 0 ||
+		readaheadInit(&readahead, maxFiles, options->readaheadWindow) != 0)
+	{
+		return -1;
 	}
-	endTime = clock();
-	double randomTime = ((double)(endTime - startTime)) / CLOCKS_PER_SEC * 1000;
+	return 0;
+}
 
-	printf("Random Access Time to Block %d: %.2f ms\n", targetIndex, randomTime);
-	printf("===============================================\n");
+const char *linkedName()
+{
+	static char strategy[32];
+	snprintf(strategy, sizeof(strategy), "linked%s%s", extentMode ? "-extent" : "", checkpointStride > 0 ? "-checkpoint" : "");
+	return strategy;
 }
 
-int main()
+int linkedInsertFile(const char *name, int blocks)
+{
+	return insertFile(name, blocks);
+}
+
+int linkedDeleteFile(const char *name)
+{
+	return deleteFile(name);
+}
+
+int linkedAccessFile(const char *name, int offset)
+{
+	return accessFile(name, offset);
+}
+
+int linkedAppendFile(const char *name, int blocks)
+{
+	return appendFile(name, blocks);
+}
+
+size_t linkedMetadataBytes()
+{
+	return metadataBytes();
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
 {
 	int choice;
 	char *fileName = malloc(20 * sizeof(char));
 	int blockCount;
-	initializeDisk();
 
-	printf("Linked File Allocation Technique\n");
+	struct SimOptions options;
+	if (parseOptions(argc, argv, &options) != 0 || linkedSetup(&options) != 0)
+	{
+		return 1;
+	}
+	struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+	if (options.workload != -1)
+	{
+		return runBenchmark(linkedName(), &handlers, metadataBytes, &options) == 0 ? 0 : 1;
+	}
+	if (options.traceFile != NULL)
+	{
+		return replayTrace(options.traceFile, &handlers) == 0 ? 0 : 1;
+	}
+
+	printf("Linked File Allocation Technique%s\n", extentMode ? " (extent mode)" : "");
 	printf("\n1. Insert a File");
 	printf("\n2. Delete a File");
 	printf("\n3. Display Disk Status");
@@ -310,3 +645,4 @@ int main()
 		}
 	}
 }
+#endif
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+
+#include "lru.h"
+
+static unsigned int bucketOf(const struct LruCache *cache, int key)
+{
+    return ((unsigned int)key * 2654435761u) & cache->mask;
+}
+
+int lruInit(struct LruCache *cache, int capacity)
+{
+    unsigned int bucketCount = 1;
+    while (bucketCount < 2u * (unsigned int)capacity)
+    {
+        bucketCount *= 2;
+    }
+    cache->entries = malloc(sizeof(struct LruEntry) * capacity);
+    cache->buckets = malloc(sizeof(int) * bucketCount);
+    if (cache->entries == NULL || cache->buckets == NULL)
+    {
+        lruDestroy(cache);
+        return -1;
+    }
+    for (unsigned int i = 0; i < bucketCount; i++)
+    {
+        cache->buckets[i] = -1;
+    }
+    cache->mask = bucketCount - 1;
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->used = 0;
+    cache->head = -1;
+    cache->tail = -1;
+    cache->freeList = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    return 0;
+}
+
+void lruDestroy(struct LruCache *cache)
+{
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+}
+
+static void unlinkRecency(struct LruCache *cache, int i)
+{
+    struct LruEntry *entry = &cache->entries[i];
+    if (entry->prev != -1)
+        cache->entries[entry->prev].next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next != -1)
+        cache->entries[entry->next].prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+}
+
+static void pushFront(struct LruCache *cache, int i)
+{
+    cache->entries[i].prev = -1;
+    cache->entries[i].next = cache->head;
+    if (cache->head != -1)
+        cache->entries[cache->head].prev = i;
+    cache->head = i;
+    if (cache->tail == -1)
+        cache->tail = i;
+}
+
+// Take entry i out of its hash chain and the recency list
+static void dropEntry(struct LruCache *cache, int i)
+{
+    int *link = &cache->buckets[bucketOf(cache, cache->entries[i].key)];
+    while (*link != i)
+    {
+        link = &cache->entries[*link].hashNext;
+    }
+    *link = cache->entries[i].hashNext;
+    unlinkRecency(cache, i);
+    cache->count--;
+}
+
+// Mark 'key' as just used. Returns 1 if it was cached, 0 if it had to be
+// brought in (evicting the least recently used key when full).
+int lruTouch(struct LruCache *cache, int key)
+{
+    unsigned int bucket = bucketOf(cache, key);
+    for (int i = cache->buckets[bucket]; i != -1; i = cache->entries[i].hashNext)
+    {
+        if (cache->entries[i].key == key)
+        {
+            unlinkRecency(cache, i);
+            pushFront(cache, i);
+            cache->hits++;
+            return 1;
+        }
+    }
+    cache->misses++;
+    if (cache->capacity == 0)
+        return 0;
+
+    int i;
+    if (cache->freeList != -1)
+    {
+        i = cache->freeList;
+        cache->freeList = cache->entries[i].next;
+    }
+    else if (cache->used < cache->capacity)
+    {
+        i = cache->used++;
+    }
+    else
+    {
+        i = cache->tail;
+        dropEntry(cache, i);
+    }
+    cache->entries[i].key = key;
+    cache->entries[i].hashNext = cache->buckets[bucket];
+    cache->buckets[bucket] = i;
+    pushFront(cache, i);
+    cache->count++;
+    return 0;
+}
+
+// Forget 'key', e.g. when its block is freed
+void lruRemove(struct LruCache *cache, int key)
+{
+    for (int i = cache->buckets[bucketOf(cache, key)]; i != -1; i = cache->entries[i].hashNext)
+    {
+        if (cache->entries[i].key == key)
+        {
+            dropEntry(cache, i);
+            cache->entries[i].next = cache->freeList;
+            cache->freeList = i;
+            return;
+        }
+    }
+}
+
+size_t lruBytes(const struct LruCache *cache)
+{
+    return sizeof(struct LruEntry) * cache->capacity + sizeof(int) * (cache->mask + 1);
+}
@@ -0,0 +1,35 @@
+#ifndef LRU_H
+#define LRU_H
+
+#include <stddef.h>
+
+// Fixed-size set of block numbers with least-recently-used eviction: a hash
+// of chained entries plus a recency list, both threaded through one array.
+struct LruEntry
+{
+    int key;
+    int prev, next; // Recency list, most recent at head; free entries use next
+    int hashNext;   // Next entry in the same bucket
+};
+
+struct LruCache
+{
+    struct LruEntry *entries;
+    int *buckets;
+    unsigned int mask; // Bucket count - 1, the count is a power of two
+    int capacity;
+    int count;
+    int used; // Entries handed out so far
+    int head, tail;
+    int freeList; // Entries released by lruRemove
+    long long hits;
+    long long misses;
+};
+
+int lruInit(struct LruCache *cache, int capacity);
+void lruDestroy(struct LruCache *cache);
+int lruTouch(struct LruCache *cache, int key);
+void lruRemove(struct LruCache *cache, int key);
+size_t lruBytes(const struct LruCache *cache);
+
+#endif
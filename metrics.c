@@ -0,0 +1,3 @@
+#include "metrics.h"
+
+unsigned long long blocksScanned = 0;
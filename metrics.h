@@ -0,0 +1,17 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-block metadata entries (bitmap bits, chain links, index entries,
+// free-extent nodes) examined by allocation and lookup. Sampled by the
+// benchmark runner.
+extern unsigned long long blocksScanned;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
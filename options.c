@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> // for getopt
+
+#include "buffer-cache.h"
+#include "device.h"
+#include "free-extents.h"
+#include "options.h"
+#include "workload.h"
+
+#define MAX_BLOCK_COUNT (1 << 30)
+#define MAX_THREADS 256
+#define MIN_BLOCK_SIZE 64
+#define MAX_BLOCK_SIZE (1 << 20)
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [-b blocks] [-f files] [-s blockSize] [-d device] [-i image] [-r blocks] [-a cache] [-g window] [-c budget] [-p fit] [-e] [-j threads] [-k stride] [-l inodes] [-m] [-v image] [-x index] [-t trace]\n", program);
+    printf("       %s [-b blocks] [-f files] -w workload [-n operations] [-u percent] [-o csv]\n", program);
+    printf("  -b blocks     Number of disk blocks (default %d, up to %d)\n", DEFAULT_BLOCK_COUNT, MAX_BLOCK_COUNT);
+    printf("  -f files      Size of the file table (default %d)\n", DEFAULT_MAX_FILES);
+    printf("  -s blockSize  Block size in bytes, a power of two (default %d)\n", DEFAULT_BLOCK_SIZE);
+    printf("  -d device     Latency model for access times: hdd or ssd (default hdd)\n");
+    printf("  -i image      Keep the blocks' bytes in this file and time real reads and writes\n");
+    printf("  -r blocks     Buffer cache in front of the device, in blocks (default none)\n");
+    printf("  -a cache      Buffer cache policy: lru, clock or arc (default lru)\n");
+    printf("  -g window     Sequential, linked and linked FAT: prefetch up to this many blocks (default none)\n");
+    printf("  -c budget     Sequential only: compact up to this many blocks per failed insert and per delete\n");
+    printf("  -p fit        Sequential only: first, best, worst or next fit (default first)\n");
+    printf("  -e            Linked and inode only: map runs of contiguous blocks as extents\n");
+    printf("  -j threads    Indexed-concurrent only: benchmark threads, up to %d (default 1)\n", MAX_THREADS);
+    printf("  -k stride     Linked only: checkpoint every stride chain nodes for O(log n) seeks\n");
+    printf("  -l inodes     Inode only: size of the LRU inode cache (default %d)\n", DEFAULT_INODE_CACHE);
+    printf("  -m            Linked FAT only: search a free-cluster bitmap instead of the FAT\n");
+    printf("  -v image      Linked FAT only: keep the FAT in a FAT12/16/32 image file, created if missing\n");
+    printf("  -x index      Indexed only: up to 1-%d levels of index blocks, or linked (default 1)\n", MAX_INDEX_LEVELS);
+    printf("  -t trace      Replay a workload trace without the menu and report throughput\n");
+    printf("  -w workload   Run a benchmark: fill, churn, large, small, zipf, repeat or scan\n");
+    printf("  -n operations Operations measured after the fill (default %d)\n", DEFAULT_BENCH_OPERATIONS);
+    printf("  -u percent    Disk utilization to fill to (default %d)\n", DEFAULT_FILL_PERCENT);
+    printf("  -o csv        Append benchmark results to this file instead of printing them\n");
+    printf("Counts accept a k, m or g suffix (e.g. -b 16m).\n");
+}
+
+// Parse a positive count with an optional k/m/g suffix, -1 if malformed
+static long long parseCount(const char *text)
+{
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    switch (*end)
+    {
+    case 'k':
+    case 'K':
+        value *= 1000LL;
+        end++;
+        break;
+    case 'm':
+    case 'M':
+        value *= 1000000LL;
+        end++;
+        break;
+    case 'g':
+    case 'G':
+        value *= 1000000000LL;
+        end++;
+        break;
+    }
+    if (end == text || *end != '\0' || value <= 0)
+        return -1;
+    return value;
+}
+
+// Fill options from the command line. Returns 0 on success, -1 after
+// printing usage if the arguments are invalid.
+int parseOptions(int argc, char **argv, struct SimOptions *options)
+{
+    options->blockCount = DEFAULT_BLOCK_COUNT;
+    options->maxFiles = DEFAULT_MAX_FILES;
+    options->blockSize = DEFAULT_BLOCK_SIZE;
+    options->traceFile = NULL;
+    options->workload = -1;
+    options->benchOperations = DEFAULT_BENCH_OPERATIONS;
+    options->fillPercent = DEFAULT_FILL_PERCENT;
+    options->benchOutput = NULL;
+    options->deviceModel = DEVICE_HDD;
+    options->cacheBlocks = 0;
+    options->cachePolicy = CACHE_LRU;
+    options->diskImage = NULL;
+    options->readaheadWindow = 0;
+    options->compactionBudget = 0;
+    options->fitPolicy = FIT_FIRST;
+    options->extentMode = 0;
+    options->checkpointStride = 0;
+    options->fatFreeMap = 0;
+    options->fatImage = NULL;
+    options->indexLevels = 1;
+    options->inodeCache = DEFAULT_INODE_CACHE;
+    options->threads = 1;
+
+    int flag;
+    long long value;
+    while ((flag = getopt(argc, argv, "b:f:s:d:i:r:a:g:c:p:ej:k:l:mv:x:t:w:n:u:o:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'b':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid block count: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->blockCount = (int)value;
+            break;
+        case 'f':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid file table size: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->maxFiles = (int)value;
+            break;
+        case 's':
+            value = parseCount(optarg);
+            if (value < MIN_BLOCK_SIZE || value > MAX_BLOCK_SIZE || (value & (value - 1)) != 0)
+            {
+                fprintf(stderr, "Invalid block size: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->blockSize = (int)value;
+            break;
+        case 'd':
+            options->deviceModel = deviceKind(optarg);
+            if (options->deviceModel == -1)
+            {
+                fprintf(stderr, "Unknown device: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'i':
+            options->diskImage = optarg;
+            break;
+        case 'r':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid buffer cache size: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->cacheBlocks = (int)value;
+            break;
+        case 'a':
+            options->cachePolicy = cachePolicyKind(optarg);
+            if (options->cachePolicy == -1)
+            {
+                fprintf(stderr, "Unknown buffer cache policy: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'g':
+            value = strcmp(optarg, "0") == 0 ? 0 : parseCount(optarg);
+            if (value < 0 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid readahead window: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->readaheadWindow = (int)value;
+            break;
+        case 'c':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid compaction budget: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->compactionBudget = (int)value;
+            break;
+        case 'p':
+            options->fitPolicy = fitPolicyKind(optarg);
+            if (options->fitPolicy == -1)
+            {
+                fprintf(stderr, "Unknown fit policy: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'e':
+            options->extentMode = 1;
+            break;
+        case 'k':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid checkpoint stride: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->checkpointStride = (int)value;
+            break;
+        case 'j':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_THREADS)
+            {
+                fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->threads = (int)value;
+            break;
+        case 'l':
+            value = parseCount(optarg);
+            if (value < 1 || value > MAX_BLOCK_COUNT)
+            {
+                fprintf(stderr, "Invalid inode cache size: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->inodeCache = (int)value;
+            break;
+        case 'm':
+            options->fatFreeMap = 1;
+            break;
+        case 'v':
+            options->fatImage = optarg;
+            break;
+        case 'x':
+            value = strcmp(optarg, "linked") == 0 ? INDEX_LINKED : parseCount(optarg);
+            if (value < 0 || value > MAX_INDEX_LEVELS)
+            {
+                fprintf(stderr, "Invalid index layout: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->indexLevels = (int)value;
+            break;
+        case 't':
+            options->traceFile = optarg;
+            break;
+        case 'w':
+            options->workload = workloadKind(optarg);
+            if (options->workload == -1)
+            {
+                fprintf(stderr, "Unknown workload: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'n':
+            value = parseCount(optarg);
+            if (value < 1)
+            {
+                fprintf(stderr, "Invalid operation count: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->benchOperations = value;
+            break;
+        case 'u':
+            value = parseCount(optarg);
+            if (value < 1 || value > 100)
+            {
+                fprintf(stderr, "Invalid fill percent: %s\n", optarg);
+                printUsage(argv[0]);
+                return -1;
+            }
+            options->fillPercent = (int)value;
+            break;
+        case 'o':
+            options->benchOutput = optarg;
+            break;
+        default:
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
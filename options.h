@@ -0,0 +1,54 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEFAULT_BLOCK_COUNT 100
+#define DEFAULT_MAX_FILES 30
+#define DEFAULT_BLOCK_SIZE 4096
+#define DEFAULT_BENCH_OPERATIONS 200000
+#define DEFAULT_FILL_PERCENT 80
+#define DEFAULT_INODE_CACHE 1024
+
+// Indexed: the index blocks form a linked list instead of a tree
+#define INDEX_LINKED 0
+#define MAX_INDEX_LEVELS 3
+
+// Disks larger than this are drawn as runs of blocks instead of a grid
+#define MAP_GRID_LIMIT 1000
+
+struct SimOptions
+{
+    int blockCount; // Number of blocks on the disk
+    int maxFiles;   // Size of the file table
+    int blockSize;  // Bytes per block
+    const char *traceFile; // Replay this workload instead of the menu, or NULL
+    int workload;          // Synthetic benchmark workload (WORKLOAD_*), or -1
+    long long benchOperations; // Operations measured after the fill phase
+    int fillPercent;       // Disk utilization the benchmark fills to
+    const char *benchOutput; // CSV file the benchmark appends to, or NULL for stdout
+    int deviceModel;       // DEVICE_HDD or DEVICE_SSD latency model
+    int cacheBlocks;       // Buffer cache size in blocks, 0 for none
+    int cachePolicy;       // CACHE_LRU, CACHE_CLOCK or CACHE_ARC
+    const char *diskImage; // Keep the blocks' bytes in this image file, or NULL
+    int readaheadWindow;   // Sequential, linked, linked FAT: most blocks read ahead, 0 for none
+    int compactionBudget;  // Sequential: blocks compacted after each delete, 0 for none
+    int fitPolicy;         // Sequential: FIT_* policy for placing files
+    int extentMode;        // Linked and inode: map runs of contiguous blocks as extents
+    int checkpointStride;  // Linked: chain nodes between seek checkpoints, 0 for none
+    int fatFreeMap;        // Linked FAT: allocate from a free-cluster bitmap
+    const char *fatImage;  // Linked FAT: keep the FAT in this mapped image, or NULL
+    int indexLevels;       // Indexed: most levels of index blocks, or INDEX_LINKED
+    int inodeCache;        // Inode: inodes kept in the in-memory inode cache
+    int threads;           // Indexed-concurrent: threads running the benchmark
+};
+
+int parseOptions(int argc, char **argv, struct SimOptions *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "device.h"
+#include "readahead.h"
+
+struct Readahead readahead;
+
+// Set up 'streamCount' idle streams prefetching up to 'maxWindow' blocks,
+// none if that is 0. Returns -1 if out of memory.
+int readaheadInit(struct Readahead *readahead, int streamCount, int maxWindow)
+{
+    free(readahead->streams);
+    memset(readahead, 0, sizeof(*readahead));
+    if (maxWindow == 0)
+        return 0;
+
+    readahead->streams = malloc(sizeof(struct ReadaheadStream) * streamCount);
+    if (readahead->streams == NULL)
+    {
+        printf("Not enough memory for %d readahead streams\n", streamCount);
+        return -1;
+    }
+    readahead->maxWindow = maxWindow;
+    readahead->streamCount = streamCount;
+    memset(readahead->streams, 0, sizeof(struct ReadaheadStream) * streamCount);
+    for (int i = 0; i < streamCount; i++)
+    {
+        readahead->streams[i].start = -1;
+    }
+    return 0;
+}
+
+// Drop the stream's prefetched blocks, e.g. when its file is deleted
+void readaheadForget(struct Readahead *readahead, int stream)
+{
+    if (readahead->maxWindow == 0)
+        return;
+    struct ReadaheadStream *s = &readahead->streams[stream];
+    readahead->discarded += s->aheadEnd - s->aheadStart;
+    s->start = -1;
+    s->expected = 0;
+    s->window = 0;
+    s->aheadStart = 0;
+    s->aheadEnd = 0;
+    s->aheadMs = 0;
+}
+
+// Find block 'offset' of the file without walking its layout from the
+// start: if the stream's reader last read the block before it, step once
+// from there with 'next', as the chain pointer came in with that block.
+// Returns 1 and sets 'at' if so, 0 if the caller has to look it up.
+int readaheadFollow(struct Readahead *readahead, int stream, int start, int offset, ReadaheadNext next,
+                    struct ReadaheadCursor *at)
+{
+    if (readahead->maxWindow == 0)
+        return 0;
+    struct ReadaheadStream *s = &readahead->streams[stream];
+    if (s->start != start || offset == 0 || offset != s->expected)
+        return 0;
+    *at = s->last;
+    return next(at);
+}
+
+// Read up to 'count' more blocks of the file past the stream's cursor,
+// one device request per contiguous run
+static void prefetch(struct Readahead *readahead, struct ReadaheadStream *s, int count, ReadaheadNext next)
+{
+    int runStart = -1, runLength = 0, fetched = 0;
+    while (fetched < count && next(&s->cursor))
+    {
+        if (runLength > 0 && s->cursor.block == runStart + runLength)
+        {
+            runLength++;
+        }
+        else
+        {
+            if (runLength > 0)
+                s->aheadMs += devicePrefetchRun(&device, runStart, runLength);
+            runStart = s->cursor.block;
+            runLength = 1;
+        }
+        fetched++;
+    }
+    if (runLength > 0)
+        s->aheadMs += devicePrefetchRun(&device, runStart, runLength);
+    if (fetched > 0)
+        readahead->refills++;
+    s->aheadEnd += fetched;
+}
+
+// Read block 'offset' of the file in slot 'stream', which starts at disk
+// block 'start' and has that block at 'at'. The block comes from the
+// stream's prefetched blocks if they hold it, else from the device. Once
+// the reader has used up half the window, the rest is prefetched by
+// following the file from its last prefetched block with 'next'.
+void readaheadRead(struct Readahead *readahead, int stream, int start, int offset, const struct ReadaheadCursor *at,
+                   ReadaheadNext next)
+{
+    if (readahead->maxWindow == 0)
+    {
+        deviceRead(&device, at->block);
+        return;
+    }
+
+    struct ReadaheadStream *s = &readahead->streams[stream];
+    if (s->start != start)
+    {
+        readaheadForget(readahead, stream);
+        s->start = start;
+    }
+
+    int prefetched = offset >= s->aheadStart && offset < s->aheadEnd;
+    if (prefetched)
+    {
+        // Blocks skipped over are dropped; each block carries an even
+        // share of the prefetch time
+        double share = s->aheadMs / (s->aheadEnd - s->aheadStart);
+        deviceReadBuffered(&device, share);
+        readahead->discarded += offset - s->aheadStart;
+        s->aheadMs -= share * (offset + 1 - s->aheadStart);
+        s->aheadStart = offset + 1;
+    }
+    else
+    {
+        deviceRead(&device, at->block);
+        readahead->discarded += s->aheadEnd - s->aheadStart;
+        s->aheadStart = offset + 1;
+        s->aheadEnd = offset + 1;
+        s->aheadMs = 0;
+        s->cursor = *at;
+    }
+
+    if (prefetched || offset == s->expected)
+    {
+        s->window = s->window == 0 ? READAHEAD_MIN_WINDOW : 2 * s->window;
+        if (s->window > readahead->maxWindow)
+            s->window = readahead->maxWindow;
+    }
+    else
+    {
+        s->window /= 2;
+    }
+    s->expected = offset + 1;
+    s->last = *at;
+
+    int ahead = s->aheadEnd - s->aheadStart;
+    if (s->window > 0 && ahead <= s->window / 2)
+        prefetch(readahead, s, s->window - ahead, next);
+}
+
+size_t readaheadBytes(const struct Readahead *readahead)
+{
+    return readahead->streamCount * sizeof(struct ReadaheadStream);
+}
@@ -0,0 +1,68 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Window a stream starts with once its reader looks sequential
+#define READAHEAD_MIN_WINDOW 4
+
+// A position in a file's block layout, moved along the file by the
+// strategy's next-block function
+struct ReadaheadCursor
+{
+    int block;   // Disk block the cursor is on
+    int run;     // Chain node holding it, for strategies that chain runs
+    int runLeft; // Blocks after it in the same contiguous run
+};
+
+// Advance 'cursor' to the file's next block. Returns 0 at the end of the
+// file, leaving the cursor where it was.
+typedef int (*ReadaheadNext)(struct ReadaheadCursor *cursor);
+
+// One reader's progress through a file
+struct ReadaheadStream
+{
+    int start;    // First disk block of the file being read, -1 when idle
+    int expected; // File offset a sequential reader asks for next
+    int window;   // Blocks kept prefetched ahead of the reader, 0 when off
+    int aheadStart, aheadEnd;      // File offsets prefetched and not yet read
+    double aheadMs;                // Time spent prefetching them
+    struct ReadaheadCursor cursor; // At file offset aheadEnd - 1
+    struct ReadaheadCursor last;   // At the block the reader asked for last
+};
+
+// Readahead for strategies that read a block at a time: one stream per
+// file slot, whose window doubles while its reader stays sequential and
+// halves when it jumps. Prefetches follow the file's own layout, so a
+// contiguous file is fetched in one run and a chained one a node at a
+// time. Prefetches are taken to overlap the reader, so the device counts
+// each prefetched block it reads as its share of the prefetch time hidden.
+struct Readahead
+{
+    int maxWindow; // 0 disables readahead
+    struct ReadaheadStream *streams;
+    int streamCount;
+    long long refills;   // Prefetches issued
+    long long discarded; // Prefetched blocks dropped unread
+};
+
+// The readahead state of the strategy in this process
+extern struct Readahead readahead;
+
+int readaheadInit(struct Readahead *readahead, int streamCount, int maxWindow);
+void readaheadForget(struct Readahead *readahead, int stream);
+int readaheadFollow(struct Readahead *readahead, int stream, int start, int offset, ReadaheadNext next,
+                    struct ReadaheadCursor *at);
+void readaheadRead(struct Readahead *readahead, int stream, int start, int offset, const struct ReadaheadCursor *at,
+                   ReadaheadNext next);
+size_t readaheadBytes(const struct Readahead *readahead);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,10 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h> // To measure access time
 
-#define MAX_DISK_SIZE 100
-#define MAX_FILES 30
+#include "bench.h"
+#include "bitmap.h"
+#include "console.h"
+#include "device.h"
+#include "directory.h"
+#include "free-extents.h"
+#include "options.h"
+#include "readahead.h"
+#include "strategy.h"
+#include "trace.h"
 
 struct FileEntry
 {
@@ -13,160 +20,656 @@ struct FileEntry
     int blockLength;
 };
 
-struct DiskBlock
+// A free run a compaction plan can move files into
+struct Hole
 {
-    int status; // 0 for free, 1 for used
+    int start;
+    int length;
 };
 
-struct DiskBlock disk[MAX_DISK_SIZE];
-int availableBlocks = MAX_DISK_SIZE;
-struct FileEntry fileEntries[MAX_FILES];
+// A block range compaction could clear, and the live blocks that clearing it
+// would move
+struct Window
+{
+    int start;
+    long long cost;
+};
 
-void initializeDisk();
-int findEmptyFileSlot();
-int findFileIndex(const char *fileName);
-void insertFile(const char *fileName, int blockCount);
-void deleteFile(const char *fileName);
-void displayDiskUsage();
-void displayDiskMap();
-void displayFiles();
-void displayFileAccessTime();
+// One file move of a compaction plan
+struct Move
+{
+    int file;
+    int from;
+    int to;
+};
 
-void initializeDisk()
+#define PLAN_WINDOWS 4 // Cheapest windows a plan tries before sliding files
+#define PLAN_FILES 32  // Most files a plan moves out of one window
+
+static int diskSize; // Number of blocks, set from the command line
+static int maxFiles; // Number of file slots
+static struct Bitmap disk; // One bit per block: 0 for free, 1 for used
+static int availableBlocks;
+static struct FileEntry *fileEntries;
+static struct Directory directory; // Name -> file slot index and free-slot stack
+static struct FreeExtentIndex freeExtents; // Free runs, indexed by start and by length
+static int fitPolicy = FIT_FIRST;
+static int compactionBudget;           // Blocks compacted per failed insert and per delete; 0 compacts on inserts only, fully
+static int compactionRuns;
+static long long compactionBlocksMoved;
+static double compactionMs;            // Simulated I/O time spent moving blocks
+static int *filesByStart;              // Live file slots in order of start block
+static int fileCount;
+static struct Move *plan;              // Compaction plan toward compactionTarget
+static int planCount, planNext;
+static int compactionTarget;           // Free run compaction works toward, 0 for none
+static int movingFile = -1;            // File being copied to movingTo, -1 for none
+static int movingTo, movingCopied;
+
+static void initializeDisk();
+static int findEmptyFileSlot();
+static int findFileIndex(const char *fileName);
+static int insertFile(const char *fileName, int blockCount);
+static int deleteFile(const char *fileName);
+static int appendFile(const char *fileName, int blockCount);
+static int accessFile(const char *fileName, int offset);
+static void orderAdd(int fileIndex);
+static void orderRemove(int fileIndex);
+static void rangeOutside(int start, int other, int length, int *rangeStart, int *rangeEnd);
+static void planCompaction(int wantedRun);
+static int compactDisk(int wantedRun, int budget);
+static void finishMove(int fileIndex);
+static void displayDiskUsage();
+static void displayDiskMap();
+static void displayFiles();
+static void displayFileAccessTime();
+static void selectFitPolicy();
+static void runCompaction();
+static size_t metadataBytes();
+
+static void initializeDisk()
 {
-    for (int i = 0; i < MAX_FILES; i++)
+    fileEntries = malloc(sizeof(struct FileEntry) * maxFiles);
+    filesByStart = malloc(sizeof(int) * maxFiles);
+    plan = malloc(sizeof(struct Move) * maxFiles);
+    if (bitmapInit(&disk, diskSize) != 0 || fileEntries == NULL || filesByStart == NULL || plan == NULL ||
+        directoryInit(&directory, maxFiles) != 0)
     {
-        fileEntries[i].fileName = NULL;
+        printf("Not enough memory for a %d-block disk.\n", diskSize);
+        exit(1);
     }
-    for (int i = 0; i < MAX_DISK_SIZE; i++)
+    availableBlocks = diskSize;
+
+    for (int i = 0; i < maxFiles; i++)
     {
-        disk[i].status = 0; // Mark all blocks as free
+        fileEntries[i].fileName = NULL;
     }
+    extentIndexInit(&freeExtents, diskSize);
 }
 
-int findEmptyFileSlot()
+static int findEmptyFileSlot()
 {
-    for (int i = 0; i < MAX_FILES; i++)
-    {
-        if (fileEntries[i].fileName == NULL)
-        {
-            return i;
-        }
-    }
-    return -1;
+    return directoryNextSlot(&directory);
 }
 
-int findFileIndex(const char *fileName)
+static int findFileIndex(const char *fileName)
 {
-    for (int i = 0; i < MAX_FILES; i++)
-    {
-        if (fileEntries[i].fileName != NULL && strcmp(fileEntries[i].fileName, fileName) == 0)
-        {
-            return i;
-        }
-    }
-    return -1;
+    return directoryLookup(&directory, fileName);
 }
 
-void insertFile(const char *fileName, int blockCount)
+static int insertFile(const char *fileName, int blockCount)
 {
+    if (blockCount <= 0)
+    {
+        consolePrintf("\nInvalid number of blocks.\n");
+        return -1;
+    }
+
     if (blockCount > availableBlocks)
     {
-        printf("\nFile size too large.\n");
-        return;
+        consolePrintf("\nFile size too large.\n");
+        return -1;
     }
 
     if (findFileIndex(fileName) != -1)
     {
-        printf("\nFile already exists.\n");
-        return;
+        consolePrintf("\nFile already exists.\n");
+        return -1;
     }
 
-    int contiguousFreeBlocks = 0;
-    int startIndex = -1;
-    for (int i = 0; i < MAX_DISK_SIZE; i++)
+    int fileSlot = findEmptyFileSlot();
+    if (fileSlot == -1)
     {
-        if (disk[i].status == 0)
-        {
-            contiguousFreeBlocks++;
-        }
-        else
-        {
-            contiguousFreeBlocks = 0;
-        }
-
-        if (contiguousFreeBlocks == blockCount)
-        {
-            startIndex = i - blockCount + 1;
-            break;
-        }
+        consolePrintf("\nNo available file slot.\n");
+        return -1;
     }
 
-    if (startIndex == -1)
+    int startIndex = extentAllocate(&freeExtents, blockCount, fitPolicy);
+    if (startIndex == -1 && compactDisk(blockCount, compactionBudget) > 0)
     {
-        printf("\nNot enough contiguous space to insert the file.\n");
-        return;
+        // There was enough free space, just not in one piece. With a budget
+        // the run may not be there yet; later deletes keep working toward it.
+        startIndex = extentAllocate(&freeExtents, blockCount, fitPolicy);
     }
-
-    int fileSlot = findEmptyFileSlot();
-    if (fileSlot == -1)
+    if (startIndex == -1)
     {
-        printf("\nNo available file slot.\n");
-        return;
+        consolePrintf("\nNot enough contiguous space to insert the file.\n");
+        return -1;
     }
 
     fileEntries[fileSlot].fileName = malloc(strlen(fileName) + 1); // Allocate memory for the file name
     strcpy(fileEntries[fileSlot].fileName, fileName);
+    directoryAdd(&directory, fileEntries[fileSlot].fileName);
     fileEntries[fileSlot].startBlock = startIndex;
     fileEntries[fileSlot].blockLength = blockCount;
     availableBlocks -= blockCount;
+    orderAdd(fileSlot);
 
-    for (int i = startIndex; i < startIndex + blockCount; i++)
-    {
-        disk[i].status = 1; // Mark blocks as used
-    }
+    bitmapSetRange(&disk, startIndex, blockCount); // Mark blocks as used
+    deviceStoreRun(&device, startIndex, blockCount);
 
-    printf("\nFile '%s' inserted successfully.\n", fileName);
-    printf("Location: Blocks %d to %d\n", startIndex, startIndex + blockCount - 1);
+    consolePrintf("\nFile '%s' inserted successfully.\n", fileName);
+    consolePrintf("Location: Blocks %d to %d\n", startIndex, startIndex + blockCount - 1);
+    return 0;
 }
 
-void deleteFile(const char *fileName)
+static int deleteFile(const char *fileName)
 {
     int fileIndex = findFileIndex(fileName);
     if (fileIndex == -1)
     {
-        printf("\nFile not found.\n");
-        return;
+        consolePrintf("\nFile not found.\n");
+        return -1;
     }
 
     int startBlock = fileEntries[fileIndex].startBlock;
     int blockLength = fileEntries[fileIndex].blockLength;
 
-    for (int i = startBlock; i < startBlock + blockLength; i++)
+    if (fileIndex == movingFile)
     {
-        disk[i].status = 0; // Mark blocks as free
+        // Drop the half-made copy too
+        int start, end;
+        rangeOutside(movingTo, startBlock, blockLength, &start, &end);
+        bitmapClearRange(&disk, start, end - start);
+        extentRelease(&freeExtents, start, end - start);
+        availableBlocks += end - start;
+        movingFile = -1;
     }
+    orderRemove(fileIndex);
+    bitmapClearRange(&disk, startBlock, blockLength); // Mark blocks as free
+    readaheadForget(&readahead, fileIndex);
 
+    extentRelease(&freeExtents, startBlock, blockLength);
     availableBlocks += blockLength;
+    directoryRemove(&directory, fileName);
     free(fileEntries[fileIndex].fileName);
     fileEntries[fileIndex].fileName = NULL;
 
-    printf("\nFile '%s' deleted successfully.\n", fileName);
-    printf("Freed %d blocks starting from block %d.\n", blockLength, startBlock);
+    consolePrintf("\nFile '%s' deleted successfully.\n", fileName);
+    consolePrintf("Freed %d blocks starting from block %d.\n", blockLength, startBlock);
+
+    if (compactionBudget > 0 && (compactionTarget > 0 || movingFile != -1))
+    {
+        compactDisk(compactionTarget, compactionBudget); // Keep working toward the run a failed insert needed
+    }
+    return 0;
+}
+
+static int appendFile(const char *fileName, int blockCount)
+{
+    int fileIndex = findFileIndex(fileName);
+    if (fileIndex == -1)
+    {
+        consolePrintf("\nFile not found.\n");
+        return -1;
+    }
+    if (blockCount <= 0 || blockCount > availableBlocks)
+    {
+        consolePrintf("\nInvalid number of blocks.\n");
+        return -1;
+    }
+    finishMove(fileIndex);
+
+    int startBlock = fileEntries[fileIndex].startBlock;
+    int blockLength = fileEntries[fileIndex].blockLength;
+
+    // Grow in place when the blocks right after the file are free
+    if (extentReserve(&freeExtents, startBlock + blockLength, blockCount) == 0)
+    {
+        bitmapSetRange(&disk, startBlock + blockLength, blockCount);
+        deviceStoreRun(&device, startBlock + blockLength, blockCount);
+        fileEntries[fileIndex].blockLength += blockCount;
+        availableBlocks -= blockCount;
+        consolePrintf("\nFile '%s' extended to blocks %d to %d.\n", fileName, startBlock, startBlock + blockLength + blockCount - 1);
+        return 0;
+    }
+
+    // Otherwise move the whole file to a run that fits its new length
+    extentRelease(&freeExtents, startBlock, blockLength);
+    int newStart = extentAllocate(&freeExtents, blockLength + blockCount, fitPolicy);
+    if (newStart == -1)
+    {
+        extentReserve(&freeExtents, startBlock, blockLength);
+        int wantedRun = blockLength + blockCount < availableBlocks ? blockLength + blockCount : availableBlocks;
+        if (compactDisk(wantedRun, compactionBudget) > 0 && extentLargest(&freeExtents) >= wantedRun)
+        {
+            return appendFile(fileName, blockCount); // Retry once the free space is in one run
+        }
+        consolePrintf("\nNot enough contiguous space to extend the file.\n");
+        return -1;
+    }
+
+    bitmapClearRange(&disk, startBlock, blockLength);
+    bitmapSetRange(&disk, newStart, blockLength + blockCount);
+    deviceStoreCopy(&device, startBlock, newStart, blockLength); // The moved file takes its data along
+    deviceStoreRun(&device, newStart + blockLength, blockCount);
+    orderRemove(fileIndex);
+    fileEntries[fileIndex].startBlock = newStart;
+    orderAdd(fileIndex);
+    fileEntries[fileIndex].blockLength += blockCount;
+    availableBlocks -= blockCount;
+
+    consolePrintf("\nFile '%s' moved to blocks %d to %d.\n", fileName, newStart, newStart + blockLength + blockCount - 1);
+    return 0;
+}
+
+// Readahead moves on to the next block until the end of the file
+static int nextBlock(struct ReadaheadCursor *cursor)
+{
+    if (cursor->runLeft == 0)
+        return 0;
+    cursor->block++;
+    cursor->runLeft--;
+    return 1;
+}
+
+// Physical block holding block 'offset' of the file, or -1
+static int accessFile(const char *fileName, int offset)
+{
+    int fileIndex = findFileIndex(fileName);
+    if (fileIndex == -1 || offset < 0 || offset >= fileEntries[fileIndex].blockLength)
+    {
+        consolePrintf("Invalid file or block index!\n");
+        return -1;
+    }
+    if (fileIndex == movingFile)
+    {
+        // Blocks already copied are read from the new place, without readahead
+        int block = (offset < movingCopied ? movingTo : fileEntries[fileIndex].startBlock) + offset;
+        deviceRead(&device, block);
+        return block;
+    }
+    struct ReadaheadCursor at;
+    at.block = fileEntries[fileIndex].startBlock + offset;
+    at.run = fileEntries[fileIndex].startBlock;
+    at.runLeft = fileEntries[fileIndex].blockLength - offset - 1;
+    readaheadRead(&readahead, fileIndex, fileEntries[fileIndex].startBlock, offset, &at, nextBlock);
+    return at.block;
+}
+
+// Position in filesByStart of the first file starting at or after 'block'
+static int orderPosition(int block)
+{
+    int low = 0, high = fileCount;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (fileEntries[filesByStart[middle]].startBlock < block)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static void orderAdd(int fileIndex)
+{
+    int position = orderPosition(fileEntries[fileIndex].startBlock);
+    memmove(filesByStart + position + 1, filesByStart + position, sizeof(int) * (fileCount - position));
+    filesByStart[position] = fileIndex;
+    fileCount++;
+}
+
+// Call before the file's startBlock changes
+static void orderRemove(int fileIndex)
+{
+    int position = orderPosition(fileEntries[fileIndex].startBlock);
+    memmove(filesByStart + position, filesByStart + position + 1, sizeof(int) * (fileCount - position - 1));
+    fileCount--;
 }
 
-void displayDiskUsage()
+// First block after the k-th file in start order, 0 before the first
+static int endOfFile(int k)
+{
+    if (k < 0)
+        return 0;
+    const struct FileEntry *file = &fileEntries[filesByStart[k]];
+    return file->startBlock + file->blockLength;
+}
+
+// First block of the k-th file in start order, diskSize past the last
+static int startOfFile(int k)
+{
+    return k < fileCount ? fileEntries[filesByStart[k]].startBlock : diskSize;
+}
+
+static int compareWindows(const void *a, const void *b)
+{
+    const struct Window *x = a, *y = b;
+    if (x->cost != y->cost)
+        return x->cost < y->cost ? -1 : 1;
+    return x->start - y->start;
+}
+
+static int compareLengthsDescending(const void *a, const void *b)
+{
+    return fileEntries[((const struct Move *)b)->file].blockLength -
+           fileEntries[((const struct Move *)a)->file].blockLength;
+}
+
+// Files filesByStart[*low..high) overlap the window of 'wantedRun' blocks
+// at 'start'. Returns high.
+static int filesInWindow(int start, int wantedRun, int *low)
+{
+    *low = orderPosition(start);
+    if (*low > 0 && endOfFile(*low - 1) > start)
+        (*low)--;
+    return orderPosition(start + wantedRun);
+}
+
+// Plan moving the files of the window at 'start' whole into the free gaps
+// outside it, each into the smallest gap that holds it, largest files
+// first. Returns the number of moves, or -1 if some file fits nowhere.
+static int planWindow(int start, int wantedRun, struct Hole *holes)
+{
+    int low, high = filesInWindow(start, wantedRun, &low);
+    if (high - low > PLAN_FILES)
+        return -1;
+
+    int holeCount = 0;
+    for (int k = 0; k <= fileCount; k++)
+    {
+        // The parts of the gap before file k on either side of the window
+        int gapStart = endOfFile(k - 1), gapEnd = startOfFile(k);
+        int pieces[2][2] = {{gapStart, gapEnd < start ? gapEnd : start},
+                            {gapStart > start + wantedRun ? gapStart : start + wantedRun, gapEnd}};
+        for (int i = 0; i < 2; i++)
+        {
+            if (pieces[i][1] > pieces[i][0])
+            {
+                holes[holeCount].start = pieces[i][0];
+                holes[holeCount].length = pieces[i][1] - pieces[i][0];
+                holeCount++;
+            }
+        }
+    }
+
+    int count = high - low;
+    for (int m = 0; m < count; m++)
+    {
+        plan[m].file = filesByStart[low + m];
+    }
+    qsort(plan, count, sizeof(struct Move), compareLengthsDescending);
+    for (int m = 0; m < count; m++)
+    {
+        int length = fileEntries[plan[m].file].blockLength;
+        int best = -1;
+        for (int h = 0; h < holeCount; h++)
+        {
+            if (holes[h].length >= length && (best == -1 || holes[h].length < holes[best].length))
+                best = h;
+        }
+        if (best == -1)
+            return -1;
+        plan[m].from = fileEntries[plan[m].file].startBlock;
+        plan[m].to = holes[best].start;
+        holes[best].start += length;
+        holes[best].length -= length;
+    }
+    return count;
+}
+
+// Plan sliding files toward block 0 in start order until the gap after
+// the last one moved holds 'wantedRun' blocks. A greedy heuristic, not a
+// minimal plan: every file after the first gap moves until then.
+static int planSlide(int wantedRun)
+{
+    int count = 0, cursor = 0;
+    for (int k = 0; k < fileCount && startOfFile(k) - cursor < wantedRun; k++)
+    {
+        const struct FileEntry *file = &fileEntries[filesByStart[k]];
+        if (file->startBlock > cursor)
+        {
+            plan[count].file = filesByStart[k];
+            plan[count].from = file->startBlock;
+            plan[count].to = cursor;
+            count++;
+        }
+        cursor += file->blockLength;
+    }
+    return count;
+}
+
+// Plan the fewest block moves that leave a free run of 'wantedRun' blocks:
+// clear the window whose files hold the fewest blocks, moving those files
+// into space that is already free outside it. Some cheapest window starts
+// or ends at the edge of a free gap, so only those are costed, and only the
+// PLAN_WINDOWS cheapest are tried, cheapest first, until one's files can
+// be placed. Failing that the plan slides files instead. Sets planCount.
+static void planCompaction(int wantedRun)
+{
+    struct Window *windows = malloc(sizeof(struct Window) * 2 * (fileCount + 1));
+    long long *prefix = malloc(sizeof(long long) * (fileCount + 1)); // prefix[k]: blocks of the first k files
+    struct Hole *holes = malloc(sizeof(struct Hole) * 2 * (fileCount + 1));
+    planCount = -1;
+    planNext = 0;
+    if (windows != NULL && prefix != NULL && holes != NULL)
+    {
+        prefix[0] = 0;
+        for (int k = 0; k < fileCount; k++)
+        {
+            prefix[k + 1] = prefix[k] + fileEntries[filesByStart[k]].blockLength;
+        }
+
+        int windowCount = 0;
+        for (int k = 0; k <= fileCount; k++)
+        {
+            int gapStart = endOfFile(k - 1), gapEnd = startOfFile(k);
+            if (gapEnd == gapStart)
+                continue;
+            int edges[2] = {gapStart, gapEnd - wantedRun};
+            for (int i = 0; i < 2; i++)
+            {
+                int start = edges[i] < 0 ? 0 : edges[i] > diskSize - wantedRun ? diskSize - wantedRun : edges[i];
+                int low, high = filesInWindow(start, wantedRun, &low);
+                windows[windowCount].start = start;
+                windows[windowCount].cost = prefix[high] - prefix[low];
+                windowCount++;
+            }
+        }
+        qsort(windows, windowCount, sizeof(struct Window), compareWindows);
+
+        for (int w = 0; w < windowCount && w < PLAN_WINDOWS && planCount == -1; w++)
+        {
+            planCount = planWindow(windows[w].start, wantedRun, holes);
+        }
+    }
+    free(windows);
+    free(prefix);
+    free(holes);
+    if (planCount == -1)
+        planCount = planSlide(wantedRun);
+}
+
+// The blocks of the range a file of 'length' blocks moving from 'from' to
+// 'to' newly takes (to) or gives up (from): all of it, or the part that
+// does not overlap the other range
+static void rangeOutside(int start, int other, int length, int *rangeStart, int *rangeEnd)
+{
+    *rangeStart = start;
+    *rangeEnd = start + length;
+    if (other < start && other + length > start)
+        *rangeStart = other + length;
+    else if (other > start && other < start + length)
+        *rangeEnd = other;
+}
+
+// Start the planned move 'move': reserve the blocks it copies into. Returns
+// 0 if the disk changed since planning so that the move no longer applies.
+static int startMove(const struct Move *move)
+{
+    const struct FileEntry *file = &fileEntries[move->file];
+    if (file->fileName == NULL || file->startBlock != move->from || move->to + file->blockLength > diskSize)
+        return 0;
+    int start, end;
+    rangeOutside(move->to, move->from, file->blockLength, &start, &end);
+    if (extentReserve(&freeExtents, start, end - start) != 0)
+        return 0;
+
+    bitmapSetRange(&disk, start, end - start);
+    availableBlocks -= end - start;
+    readaheadForget(&readahead, move->file);
+    movingFile = move->file;
+    movingTo = move->to;
+    movingCopied = 0;
+    return 1;
+}
+
+// Copy up to 'budget' more blocks (0 for all) of the file being moved and,
+// once all are copied, switch the file over and free the blocks it left.
+// Returns the number of blocks copied.
+static int continueMove(int budget)
+{
+    struct FileEntry *file = &fileEntries[movingFile];
+    int count = file->blockLength - movingCopied;
+    if (budget > 0 && count > budget)
+        count = budget;
+    compactionMs += deviceMoveRun(&device, file->startBlock + movingCopied, movingTo + movingCopied, count);
+    movingCopied += count;
+    if (movingCopied < file->blockLength)
+        return count;
+
+    int start, end;
+    rangeOutside(file->startBlock, movingTo, file->blockLength, &start, &end);
+    extentRelease(&freeExtents, start, end - start);
+    bitmapClearRange(&disk, start, end - start);
+    availableBlocks += end - start;
+    orderRemove(movingFile);
+    file->startBlock = movingTo;
+    orderAdd(movingFile);
+    movingFile = -1;
+    return count;
+}
+
+// Work toward a free run of 'wantedRun' blocks, moving at most 'budget'
+// blocks (0 for no limit). The plan is made once per target and carried
+// out across calls, a move at a time; a file is copied over several calls
+// if the budget runs out part way and switches to its new place when the
+// copy is complete. A plan whose next move no longer applies is dropped and
+// made again on the next call. Returns the number of blocks moved.
+static int compactDisk(int wantedRun, int budget)
+{
+    if (wantedRun != compactionTarget)
+    {
+        compactionTarget = wantedRun;
+        planCount = 0;
+        planNext = 0;
+    }
+
+    int blocksMoved = 0;
+    int filesMoved = 0;
+    int planned = 0;
+    double startMs = compactionMs;
+    while (budget == 0 || blocksMoved < budget)
+    {
+        if (movingFile != -1)
+        {
+            blocksMoved += continueMove(budget == 0 ? 0 : budget - blocksMoved);
+            if (movingFile != -1)
+                break;
+            filesMoved++;
+            continue;
+        }
+        if (compactionTarget == 0 || compactionTarget > availableBlocks ||
+            extentLargest(&freeExtents) >= compactionTarget)
+        {
+            compactionTarget = 0;
+            planCount = 0;
+            planNext = 0;
+            break;
+        }
+        if (planNext == planCount)
+        {
+            if (planned)
+                break; // The plan is spent without reaching the target, try again next call
+            planCompaction(compactionTarget);
+            planned = 1;
+            continue;
+        }
+        if (!startMove(&plan[planNext++]))
+        {
+            planCount = 0; // The disk changed since planning
+            planNext = 0;
+        }
+    }
+
+    if (blocksMoved > 0)
+    {
+        compactionRuns++;
+        compactionBlocksMoved += blocksMoved;
+        consolePrintf("\nCompaction moved %d blocks, finishing %d files (%.2f ms simulated I/O).\n",
+                      blocksMoved, filesMoved, compactionMs - startMs);
+    }
+    return blocksMoved;
+}
+
+// Complete the move of 'fileIndex', if it is under way, before the file
+// is changed or read whole
+static void finishMove(int fileIndex)
+{
+    if (fileIndex == movingFile)
+    {
+        int blocksMoved = continueMove(0);
+        compactionBlocksMoved += blocksMoved;
+    }
+}
+
+static void displayDiskUsage()
 {
     printf("\n================== DISK INFO ==================\n");
-    printf("Total size: %d blocks\n", MAX_DISK_SIZE);
-    printf("Free space: %d blocks\n", availableBlocks);
-    printf("Used space: %d blocks\n", MAX_DISK_SIZE - availableBlocks);
+    printf("Total size: %d blocks\n", diskSize);
+    int usedBlocks = bitmapCountSet(&disk);
+    printf("Free space: %d blocks\n", diskSize - usedBlocks);
+    printf("Used space: %d blocks\n", usedBlocks);
+    printf("Free extents: %d (largest: %d blocks)\n", freeExtents.extentCount, extentLargest(&freeExtents));
+    printf("Fit policy: %s\n", fitPolicyName(fitPolicy));
+    if (compactionRuns > 0)
+    {
+        printf("Compaction: %d runs, %lld blocks moved, %.2f ms simulated I/O\n",
+               compactionRuns, compactionBlocksMoved, compactionMs);
+    }
     printf("===============================================\n");
 }
 
-void displayDiskMap()
+static void displayDiskMap()
 {
     printf("\n=================== DISK MAP ===================\n");
+    if (diskSize > MAP_GRID_LIMIT)
+    {
+        // Too many blocks for a grid, list runs of equal status instead
+        for (int runStart = 0; runStart < diskSize;)
+        {
+            int used = bitmapTest(&disk, runStart);
+            int runEnd = used ? bitmapFindClear(&disk, runStart) : bitmapFindSet(&disk, runStart);
+            if (runEnd == -1)
+                runEnd = diskSize;
+            printf("Blocks %d to %d: %s\n", runStart, runEnd - 1, used ? "used" : "free");
+            runStart = runEnd;
+        }
+        printf("===============================================\n");
+        return;
+    }
+
     printf("     ");
     for (int j = 0; j < 10; j++)
     {
@@ -174,24 +677,24 @@ void displayDiskMap()
     }
     printf("\n");
 
-    for (int i = 0; i < MAX_DISK_SIZE; i++)
+    for (int i = 0; i < diskSize; i++)
     {
         if (i % 10 == 0)
         {
             printf("\n%3d  ", i);
         }
-        printf("[%2d] ", disk[i].status);
+        printf("[%2d] ", bitmapTest(&disk, i));
     }
     printf("\n===============================================\n");
 }
 
-void displayFiles()
+static void displayFiles()
 {
     printf("\n================ FILES IN DISK ================\n");
     printf("%-20s %-10s %-10s %-s\n", "File Name", "Start", "Length", "Blocks");
     printf("-----------------------------------------------\n");
 
-    for (int i = 0; i < MAX_FILES; i++)
+    for (int i = 0; i < maxFiles; i++)
     {
         if (fileEntries[i].fileName != NULL)
         {
@@ -200,9 +703,16 @@ void displayFiles()
                    fileEntries[i].startBlock,
                    fileEntries[i].blockLength);
 
-            for (int j = fileEntries[i].startBlock; j < fileEntries[i].startBlock + fileEntries[i].blockLength; j++)
+            if (diskSize > MAP_GRID_LIMIT)
             {
-                printf("%d ", j);
+                printf("%d .. %d ", fileEntries[i].startBlock, fileEntries[i].startBlock + fileEntries[i].blockLength - 1);
+            }
+            else
+            {
+                for (int j = fileEntries[i].startBlock; j < fileEntries[i].startBlock + fileEntries[i].blockLength; j++)
+                {
+                    printf("%d ", j);
+                }
             }
             printf("]\n");
         }
@@ -210,7 +720,7 @@ void displayFiles()
     printf("===============================================\n\n");
 }
 
-void displayFileAccessTime()
+static void displayFileAccessTime()
 {
     char fileName[20];
     printf("Enter file name: ");
@@ -224,6 +734,7 @@ void displayFileAccessTime()
         printf("File not found!\n");
         return;
     }
+    finishMove(fileIndex);
 
     int startBlock = fileEntries[fileIndex].startBlock;
     int length = fileEntries[fileIndex].blockLength;
@@ -231,19 +742,11 @@ void displayFileAccessTime()
     printf("Start Block: %d\n", startBlock);
     printf("Length: %d blocks\n", length);
 
-    // Measure sequential access time
-    clock_t start = clock();
-    for (int i = startBlock; i < startBlock + length; i++)
-    {
-        struct timespec delay = {0, 5 * 1000000L}; // 5ms
-        nanosleep(&delay, NULL);
-    }
-    clock_t end = clock();
-    double sequentialAccessTime = ((double)(end - start)) / CLOCKS_PER_SEC * 1000;
-
-    printf("Sequential Access Time: %.2f ms\n", sequentialAccessTime);
+    // The file is contiguous: one positioning delay, then back-to-back transfers
+    double sequentialAccessTime = deviceReadRun(&device, startBlock, length);
+    printf("Sequential Access Time: %.2f ms (%s)\n", sequentialAccessTime, deviceName(device.kind));
 
-    // Measure random access time
+    // Random access goes straight to the block's address
     int targetBlock;
     printf("Enter target block index (relative to file start, 0 to %d): ", length - 1);
     scanf("%d", &targetBlock);
@@ -254,34 +757,139 @@ void displayFileAccessTime()
         return;
     }
 
-    int targetAbsoluteBlock = startBlock + targetBlock;
-    start = clock();
-    for (int i = startBlock; i <= targetAbsoluteBlock; i++)
-    {
-        struct timespec delay = {0, 5 * 1000000L}; // 5ms
-        nanosleep(&delay, NULL);
-    }
-    end = clock();
-    double randomAccessTime = ((double)(end - start)) / CLOCKS_PER_SEC * 1000;
+    double start = device.clockMs;
+    int targetAbsoluteBlock = accessFile(fileName, targetBlock);
+    double randomAccessTime = device.clockMs - start;
 
     printf("Random Access Time to Block %d (absolute index: %d): %.2f ms\n",
            targetBlock, targetAbsoluteBlock, randomAccessTime);
 }
 
-int main()
+static void runCompaction()
+{
+    printf("Enter free run length to make (0 for all free space): ");
+    int wantedRun;
+    scanf("%d", &wantedRun);
+    printf("Enter block move budget (0 to compact completely): ");
+    int budget;
+    scanf("%d", &budget);
+
+    if (wantedRun < 0 || wantedRun > availableBlocks || budget < 0)
+    {
+        printf("Invalid run length or budget!\n");
+        return;
+    }
+    if (compactDisk(wantedRun == 0 ? availableBlocks : wantedRun, budget) == 0)
+    {
+        printf("Nothing to compact.\n");
+    }
+}
+
+static void selectFitPolicy()
+{
+    printf("\n1. First fit\n2. Best fit\n3. Worst fit\n4. Next fit\n");
+    printf("Enter fit policy: ");
+    int policy;
+    scanf("%d", &policy);
+
+    if (policy < 1 || policy > 4)
+    {
+        printf("Invalid fit policy!\n");
+        return;
+    }
+    fitPolicy = policy - 1;
+    printf("Fit policy set to %s.\n", fitPolicyName(fitPolicy));
+}
+
+// Memory used to track files and free space, for the benchmark
+static size_t metadataBytes()
+{
+    return disk.wordCount * sizeof(uint64_t) + maxFiles * sizeof(struct FileEntry) +
+           directoryBytes(&directory) + freeExtents.extentCount * sizeof(struct FreeExtent) +
+           maxFiles * (sizeof(int) + sizeof(struct Move)) + readaheadBytes(&readahead);
+}
+
+// Entry points for programs that link several simulators (strategy.h)
+
+int sequentialSetup(const struct SimOptions *options)
+{
+    diskSize = options->blockCount;
+    maxFiles = options->maxFiles;
+    compactionBudget = options->compactionBudget;
+    fitPolicy = options->fitPolicy;
+
+    initializeDisk();
+    if (deviceInit(&device, options->deviceModel, diskSize, options->blockSize, options->cachePolicy,
+                   options->cacheBlocks) != 0 ||
+        deviceAttachImage(&device, options->diskImage) != 0 ||
+        readaheadInit(&readahead, maxFiles, options->readaheadWindow) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+const char *sequentialName()
+{
+    static const char *strategies[] = {"sequential", "sequential-best-fit", "sequential-worst-fit", "sequential-next-fit"};
+    return strategies[fitPolicy];
+}
+
+int sequentialInsertFile(const char *name, int blocks)
+{
+    return insertFile(name, blocks);
+}
+
+int sequentialDeleteFile(const char *name)
+{
+    return deleteFile(name);
+}
+
+int sequentialAccessFile(const char *name, int offset)
+{
+    return accessFile(name, offset);
+}
+
+int sequentialAppendFile(const char *name, int blocks)
+{
+    return appendFile(name, blocks);
+}
+
+size_t sequentialMetadataBytes()
+{
+    return metadataBytes();
+}
+
+#ifndef SIMULATOR_LIBRARY
+int main(int argc, char **argv)
 {
     int choice;
     char fileName[20];
     int blockCount;
 
-    initializeDisk();
+    struct SimOptions options;
+    if (parseOptions(argc, argv, &options) != 0 || sequentialSetup(&options) != 0)
+    {
+        return 1;
+    }
+    struct TraceHandlers handlers = {insertFile, deleteFile, accessFile, appendFile};
+    if (options.workload != -1)
+    {
+        return runBenchmark(sequentialName(), &handlers, metadataBytes, &options) == 0 ? 0 : 1;
+    }
+    if (options.traceFile != NULL)
+    {
+        return replayTrace(options.traceFile, &handlers) == 0 ? 0 : 1;
+    }
     printf("Sequential File Allocation Technique\n\n");
     printf("\n1. Insert a File");
     printf("\n2. Delete a File");
     printf("\n3. Display the Disk");
     printf("\n4. Display All Files");
     printf("\n5. Display File Access Time");
-    printf("\n6. Exit\n");
+    printf("\n6. Select Fit Policy");
+    printf("\n7. Compact Disk");
+    printf("\n8. Exit\n");
 
     while (1)
     {
@@ -317,10 +925,20 @@ int main()
             displayFileAccessTime();
             break;
         case 6:
+            selectFitPolicy();
+            break;
+        case 7:
+            runCompaction();
+            break;
+        case 8:
+            extentIndexDestroy(&freeExtents);
+            bitmapDestroy(&disk);
+            directoryDestroy(&directory);
             exit(0);
         default:
             printf("Invalid choice. Please try again.\n");
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
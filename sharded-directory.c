@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sharded-directory.h"
+
+// Split 'slotCount' file-table slots over up to DIRECTORY_SHARDS shards of
+// at least DIRECTORY_SHARD_SLOTS each. A shard whose slots run out fails
+// inserts even if other shards have room. Returns -1 if out of memory.
+int shardedDirectoryInit(struct ShardedDirectory *sharded, int slotCount)
+{
+    sharded->shardBits = 0;
+    while ((1 << sharded->shardBits) < DIRECTORY_SHARDS &&
+           slotCount >> (sharded->shardBits + 1) >= DIRECTORY_SHARD_SLOTS)
+    {
+        sharded->shardBits++;
+    }
+    sharded->shardCount = 1 << sharded->shardBits;
+    sharded->shards = aligned_alloc(64, sizeof(struct DirectoryShard) * sharded->shardCount);
+    if (sharded->shards == NULL)
+    {
+        sharded->shardCount = 0;
+        return -1;
+    }
+    // Cleared so the cleanup after a failed directoryInit never frees a
+    // pointer that was not set
+    memset(sharded->shards, 0, sizeof(struct DirectoryShard) * sharded->shardCount);
+
+    int perShard = slotCount / sharded->shardCount;
+    for (int i = 0; i < sharded->shardCount; i++)
+    {
+        struct DirectoryShard *shard = &sharded->shards[i];
+        shard->firstSlot = i * perShard;
+        int slots = i == sharded->shardCount - 1 ? slotCount - shard->firstSlot : perShard;
+        pthread_mutex_init(&shard->lock, NULL);
+        if (directoryInit(&shard->directory, slots) != 0)
+        {
+            sharded->shardCount = i + 1;
+            shardedDirectoryDestroy(sharded);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void shardedDirectoryDestroy(struct ShardedDirectory *sharded)
+{
+    for (int i = 0; i < sharded->shardCount; i++)
+    {
+        pthread_mutex_destroy(&sharded->shards[i].lock);
+        directoryDestroy(&sharded->shards[i].directory);
+    }
+    free(sharded->shards);
+    sharded->shards = NULL;
+    sharded->shardCount = 0;
+}
+
+size_t shardedDirectoryBytes(const struct ShardedDirectory *sharded)
+{
+    size_t bytes = sizeof(struct DirectoryShard) * sharded->shardCount;
+    for (int i = 0; i < sharded->shardCount; i++)
+    {
+        bytes += directoryBytes(&sharded->shards[i].directory);
+    }
+    return bytes;
+}
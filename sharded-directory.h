@@ -0,0 +1,42 @@
+#ifndef SHARDED_DIRECTORY_H
+#define SHARDED_DIRECTORY_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "directory.h"
+
+#define DIRECTORY_SHARDS 256     // Most shards, a power of two
+#define DIRECTORY_SHARD_SLOTS 64 // Fewest file-table slots per shard
+
+// A directory split by name hash into shards, each with its own lock and
+// its own range of file-table slots, so threads working on different files
+// rarely wait for each other. The caller holds a shard's lock while it
+// uses the shard's directory and the file-table slots it owns.
+struct DirectoryShard
+{
+    pthread_mutex_t lock;
+    struct Directory directory; // Slots are relative to firstSlot
+    int firstSlot;
+} __attribute__((aligned(64))); // One cache line per lock
+
+struct ShardedDirectory
+{
+    struct DirectoryShard *shards;
+    int shardCount;
+    int shardBits;
+};
+
+int shardedDirectoryInit(struct ShardedDirectory *sharded, int slotCount);
+void shardedDirectoryDestroy(struct ShardedDirectory *sharded);
+size_t shardedDirectoryBytes(const struct ShardedDirectory *sharded);
+
+// Shard responsible for 'name'
+static inline struct DirectoryShard *shardedDirectoryShard(const struct ShardedDirectory *sharded, const char *name)
+{
+    if (sharded->shardBits == 0)
+        return &sharded->shards[0];
+    return &sharded->shards[(directoryHash(name) * 2654435761u) >> (32 - sharded->shardBits)];
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <stddef.h>
+
+#include "options.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Entry points each simulator exports so several can be linked into one
+// program. Setup builds the disk from the options and must be called once,
+// before the others; it returns -1 on failure. Name is the strategy as the
+// benchmark reports it, which depends on the options. The file routines
+// return -1 on failure like the simulators' own. Each simulator's disk and
+// tables are private to it, but all of them share the device model and the
+// blocksScanned counter.
+
+int sequentialSetup(const struct SimOptions *options);
+const char *sequentialName(void);
+int sequentialInsertFile(const char *name, int blocks);
+int sequentialDeleteFile(const char *name);
+int sequentialAccessFile(const char *name, int offset);
+int sequentialAppendFile(const char *name, int blocks);
+size_t sequentialMetadataBytes(void);
+
+int linkedSetup(const struct SimOptions *options);
+const char *linkedName(void);
+int linkedInsertFile(const char *name, int blocks);
+int linkedDeleteFile(const char *name);
+int linkedAccessFile(const char *name, int offset);
+int linkedAppendFile(const char *name, int blocks);
+size_t linkedMetadataBytes(void);
+
+int linkedFatSetup(const struct SimOptions *options);
+const char *linkedFatName(void);
+int linkedFatInsertFile(const char *name, int blocks);
+int linkedFatDeleteFile(const char *name);
+int linkedFatAccessFile(const char *name, int offset);
+int linkedFatAppendFile(const char *name, int blocks);
+size_t linkedFatMetadataBytes(void);
+void linkedFatClose(void); // Flushes a mapped FAT image (-g); the others hold no files
+
+int indexedSetup(const struct SimOptions *options);
+const char *indexedName(void);
+int indexedInsertFile(const char *name, int blocks);
+int indexedDeleteFile(const char *name);
+int indexedAccessFile(const char *name, int offset);
+int indexedAppendFile(const char *name, int blocks);
+size_t indexedMetadataBytes(void);
+
+int inodeSetup(const struct SimOptions *options);
+const char *inodeName(void);
+int inodeInsertFile(const char *name, int blocks);
+int inodeDeleteFile(const char *name);
+int inodeAccessFile(const char *name, int offset);
+int inodeAppendFile(const char *name, int blocks);
+size_t inodeMetadataBytes(void);
+
+// Thread-safe: the file routines can be called from several threads at once
+int indexedConcurrentSetup(const struct SimOptions *options);
+const char *indexedConcurrentName(void);
+int indexedConcurrentInsertFile(const char *name, int blocks);
+int indexedConcurrentDeleteFile(const char *name);
+int indexedConcurrentAccessFile(const char *name, int offset);
+int indexedConcurrentAppendFile(const char *name, int blocks);
+size_t indexedConcurrentMetadataBytes(void);
+void indexedConcurrentFlushThread(void); // Call in each thread when it is done
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h> // for getopt, readlink
+#include <vector>
+
+#include "trace.h"
+#include "work-pool.hpp"
+
+extern char **environ;
+
+// Simulator flags a sweep can vary: those taking a value, and the switches
+// (e, m) whose values are 0 or 1. Trace, output and help flags belong to
+// the sweep itself.
+static const char *valueFlags = "bfsdragcpjklvxwnu";
+static const char *switchFlags = "em";
+static const char *everyProgram[] = {"sequential", "linked", "linked-fat", "indexed", "inode"};
+
+// One parameter of the grid: a simulator flag, or "program"
+struct Axis
+{
+    std::string name;
+    std::vector<std::string> values;
+};
+
+// One simulation instance and what it printed
+struct Point
+{
+    std::string program;
+    std::vector<std::string> arguments; // Simulator flags, without the program
+    int status = -1;
+    std::string header; // The CSV header the program printed
+    std::string row;
+    std::string errors; // Its stderr
+};
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [-j workers] [-o csv] [-J json] [-P directory] axis=value,value... ...\n", program);
+    printf("  -j workers    Instances run at once (default: one per core)\n");
+    printf("  -o csv        Write the merged CSV here instead of stdout\n");
+    printf("  -J json       Also write the results as a JSON array\n");
+    printf("  -P directory  Where the simulator programs are (default: next to %s)\n", program);
+    printf("An axis is 'program' (sequential, linked, linked-fat, indexed, inode or\n");
+    printf("indexed-concurrent; default the first five) or a simulator flag without its\n");
+    printf("dash, e.g. b=10k,100k w=churn,small p=first,best e=0,1. Every combination of\n");
+    printf("the values is run as its own process. w defaults to churn.\n");
+}
+
+static std::vector<std::string> splitValues(const std::string &text)
+{
+    std::vector<std::string> values;
+    size_t start = 0;
+    while (true)
+    {
+        size_t comma = text.find(',', start);
+        values.push_back(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos)
+            return values;
+        start = comma + 1;
+    }
+}
+
+// Parse "name=value,value". Returns false after printing why if malformed.
+static bool parseAxis(const char *text, Axis &axis)
+{
+    const char *equals = strchr(text, '=');
+    if (equals == nullptr || equals == text || equals[1] == '\0')
+    {
+        fprintf(stderr, "Axis must be name=value,...: %s\n", text);
+        return false;
+    }
+    axis.name.assign(text, equals - text);
+    axis.values = splitValues(equals + 1);
+    bool isSwitch = axis.name.size() == 1 && strchr(switchFlags, axis.name[0]) != nullptr;
+    if (axis.name != "program" && (axis.name.size() != 1 || (strchr(valueFlags, axis.name[0]) == nullptr && !isSwitch)))
+    {
+        fprintf(stderr, "Not a flag a sweep can vary: %s\n", axis.name.c_str());
+        return false;
+    }
+    for (const std::string &value : axis.values)
+    {
+        if (value.empty() || (isSwitch && value != "0" && value != "1"))
+        {
+            fprintf(stderr, "Invalid value '%s' for %s\n", value.c_str(), axis.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every combination of the axes' values, the first axis varying slowest
+static std::vector<Point> expandGrid(const std::vector<Axis> &axes)
+{
+    std::vector<Point> points(1);
+    for (const Axis &axis : axes)
+    {
+        std::vector<Point> expanded;
+        for (const Point &point : points)
+        {
+            for (const std::string &value : axis.values)
+            {
+                Point next = point;
+                if (axis.name == "program")
+                {
+                    next.program = value;
+                }
+                else if (strchr(switchFlags, axis.name[0]) != nullptr)
+                {
+                    if (value == "1")
+                        next.arguments.push_back("-" + axis.name);
+                }
+                else
+                {
+                    next.arguments.push_back("-" + axis.name);
+                    next.arguments.push_back(value);
+                }
+                expanded.push_back(next);
+            }
+        }
+        points.swap(expanded);
+    }
+    return points;
+}
+
+static std::string joinArguments(const Point &point)
+{
+    std::string text;
+    for (const std::string &argument : point.arguments)
+    {
+        text += (text.empty() ? "" : " ") + argument;
+    }
+    return text;
+}
+
+static std::string readAll(FILE *file)
+{
+    std::string text;
+    char buffer[4096];
+    rewind(file);
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, length);
+    }
+    return text;
+}
+
+// Run one instance as its own process, so it owns the simulator's globals,
+// and keep the CSV header and row it prints
+static void runPoint(const std::string &directory, Point &point)
+{
+    std::string path = directory + "/" + point.program + ".out";
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(path.c_str()));
+    for (std::string &argument : point.arguments)
+    {
+        argv.push_back(const_cast<char *>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    FILE *output = tmpfile();
+    FILE *errors = tmpfile();
+    if (output == nullptr || errors == nullptr)
+    {
+        point.errors = std::string("tmpfile: ") + strerror(errno);
+        if (output != nullptr)
+            fclose(output);
+        if (errors != nullptr)
+            fclose(errors);
+        return;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fileno(output), STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fileno(errors), STDERR_FILENO);
+    pid_t child;
+    int spawned = posix_spawn(&child, path.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (spawned != 0)
+    {
+        point.errors = path + ": " + strerror(spawned);
+    }
+    else
+    {
+        int status;
+        waitpid(child, &status, 0);
+        point.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        point.errors = readAll(errors);
+
+        // The program prints the header, then its row
+        std::string text = readAll(output);
+        size_t lineEnd = text.find('\n');
+        if (point.status == 0 && lineEnd != std::string::npos)
+        {
+            point.header = text.substr(0, lineEnd);
+            size_t rowEnd = text.find('\n', lineEnd + 1);
+            point.row = text.substr(lineEnd + 1, rowEnd == std::string::npos ? std::string::npos : rowEnd - lineEnd - 1);
+        }
+    }
+    fclose(output);
+    fclose(errors);
+}
+
+// JSON string literal; simulator output has no control characters
+static std::string quote(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static bool isNumber(const std::string &text)
+{
+    char *end;
+    strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+static void writeJson(FILE *file, const std::vector<Point> &points)
+{
+    fputs("[\n", file);
+    bool first = true;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const Point &point = points[i];
+        if (point.row.empty())
+            continue;
+        fprintf(file, "%s  {\"point\": %zu, \"program\": %s, \"arguments\": %s", first ? "" : ",\n", i,
+                quote(point.program).c_str(), quote(joinArguments(point)).c_str());
+        std::vector<std::string> names = splitValues(point.header);
+        std::vector<std::string> values = splitValues(point.row);
+        for (size_t column = 0; column < names.size() && column < values.size(); column++)
+        {
+            const std::string &value = values[column];
+            fprintf(file, ", %s: %s", quote(names[column]).c_str(), isNumber(value) ? value.c_str() : quote(value).c_str());
+        }
+        fputs("}", file);
+        first = false;
+    }
+    fputs("\n]\n", file);
+}
+
+// Directory holding this program, where the build puts the simulators too
+static std::string ownDirectory(const char *argv0)
+{
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    std::string self = length > 0 ? std::string(path, length) : std::string(argv0);
+    size_t slash = self.rfind('/');
+    return slash == std::string::npos ? "." : self.substr(0, slash);
+}
+
+// Expand a parameter grid into simulator runs, run them on a work-stealing
+// pool, and merge their CSV rows into one report in grid order.
+int main(int argc, char **argv)
+{
+    int workers = static_cast<int>(std::thread::hardware_concurrency());
+    const char *csvPath = nullptr;
+    const char *jsonPath = nullptr;
+    std::string directory = ownDirectory(argv[0]);
+    int flag;
+    while ((flag = getopt(argc, argv, "j:o:J:P:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'j':
+            workers = atoi(optarg);
+            if (workers < 1)
+            {
+                fprintf(stderr, "Invalid worker count: %s\n", optarg);
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            csvPath = optarg;
+            break;
+        case 'J':
+            jsonPath = optarg;
+            break;
+        case 'P':
+            directory = optarg;
+            break;
+        default:
+            printUsage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (workers < 1)
+        workers = 1;
+
+    std::vector<Axis> axes;
+    bool hasProgram = false, hasWorkload = false;
+    for (int i = optind; i < argc; i++)
+    {
+        Axis axis;
+        if (!parseAxis(argv[i], axis))
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        hasProgram |= axis.name == "program";
+        hasWorkload |= axis.name == "w";
+        axes.push_back(axis);
+    }
+    if (!hasProgram)
+        axes.insert(axes.begin(), Axis{"program", std::vector<std::string>(std::begin(everyProgram), std::end(everyProgram))});
+    if (!hasWorkload)
+        axes.push_back(Axis{"w", {"churn"}});
+
+    std::vector<Point> points = expandGrid(axes);
+    fsalloc::WorkPool pool(workers);
+    double start = wallSeconds();
+    pool.run(points.size(), [&](size_t i) { runPoint(directory, points[i]); });
+    double seconds = wallSeconds() - start;
+
+    FILE *csv = stdout;
+    if (csvPath != nullptr && (csv = fopen(csvPath, "w")) == nullptr)
+    {
+        perror(csvPath);
+        return 1;
+    }
+    int failed = 0;
+    bool headerWritten = false;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const Point &point = points[i];
+        if (point.row.empty())
+        {
+            // First line of what went wrong
+            std::string reason = point.errors.substr(0, point.errors.find('\n'));
+            fprintf(stderr, "Point %zu (%s %s) failed: %s\n", i, point.program.c_str(), joinArguments(point).c_str(),
+                    reason.empty() ? "no result" : reason.c_str());
+            failed++;
+            continue;
+        }
+        if (!headerWritten)
+        {
+            fprintf(csv, "point,program,arguments,%s\n", point.header.c_str());
+            headerWritten = true;
+        }
+        fprintf(csv, "%zu,%s,%s,%s\n", i, point.program.c_str(), joinArguments(point).c_str(), point.row.c_str());
+    }
+    if (csv != stdout)
+        fclose(csv);
+
+    if (jsonPath != nullptr)
+    {
+        FILE *json = fopen(jsonPath, "w");
+        if (json == nullptr)
+        {
+            perror(jsonPath);
+            return 1;
+        }
+        writeJson(json, points);
+        fclose(json);
+    }
+    fprintf(stderr, "%zu instances (%d failed) on %d workers in %.1f s, %lld stolen\n", points.size(), failed,
+            pool.workers(), seconds, pool.steals());
+    return failed == 0 ? 0 : 1;
+}
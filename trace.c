@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "block-store.h"
+#include "buffer-cache.h"
+#include "console.h"
+#include "readahead.h"
+#include "device.h"
+#include "trace.h"
+
+static const char *opNames[TRACE_OP_TYPES] = {"insert", "delete", "access", "append"};
+
+// Parse "insert <name> <blocks>", "delete <name>", "access <name> <offset>"
+// or "append <name> <blocks>". Returns 1 for an operation, 0 for a blank or
+// comment line and -1 for a malformed one.
+int parseTraceLine(const char *line, struct TraceOp *op)
+{
+    char verb[16];
+    int fields = sscanf(line, "%15s %63s %d", verb, op->name, &op->value);
+    if (fields < 1 || verb[0] == '#')
+        return 0;
+
+    for (int type = 0; type < TRACE_OP_TYPES; type++)
+    {
+        if (strcmp(verb, opNames[type]) == 0)
+        {
+            op->type = type;
+            if (fields < 2 || (type != TRACE_DELETE && fields < 3))
+                return -1;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+int applyTraceOp(const struct TraceHandlers *handlers, const struct TraceOp *op, struct ReplayStats *stats)
+{
+    int result;
+    switch (op->type)
+    {
+    case TRACE_INSERT:
+        result = handlers->insertFile(op->name, op->value);
+        break;
+    case TRACE_DELETE:
+        result = handlers->deleteFile(op->name);
+        break;
+    case TRACE_ACCESS:
+        result = handlers->accessFile(op->name, op->value);
+        break;
+    default:
+        result = handlers->appendFile(op->name, op->value);
+        break;
+    }
+
+    stats->count[op->type]++;
+    if (result == -1)
+        stats->failed[op->type]++;
+    return result;
+}
+
+double wallSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+long long replayTotal(const struct ReplayStats *stats)
+{
+    long long total = 0;
+    for (int type = 0; type < TRACE_OP_TYPES; type++)
+        total += stats->count[type];
+    return total;
+}
+
+void printReplayStats(const struct ReplayStats *stats)
+{
+    long long total = replayTotal(stats);
+    printf("\n================ REPLAY SUMMARY ================\n");
+    for (int type = 0; type < TRACE_OP_TYPES; type++)
+    {
+        printf("%-8s %12lld ops %12lld failed\n", opNames[type], stats->count[type], stats->failed[type]);
+    }
+    printf("Total:   %12lld ops in %.3f s\n", total, stats->seconds);
+    printf("Throughput: %.0f ops/s\n", stats->seconds > 0 ? total / stats->seconds : 0.0);
+    printf("Simulated %s time: %.3f s\n", deviceName(device.kind), stats->deviceMs / 1000);
+    if (device.cache != NULL)
+    {
+        const struct BufferCache *cache = device.cache;
+        long long lookups = cache->hits + cache->misses;
+        printf("Cache (%s, %d blocks): %.1f%% hits, %lld evictions, %.4f ms per block read\n",
+               cachePolicyName(cache->policy), cache->capacity, lookups > 0 ? 100.0 * cache->hits / lookups : 0.0,
+               cache->evictions, device.readRequests > 0 ? device.readMs / device.readRequests : 0.0);
+    }
+    if (readahead.maxWindow > 0)
+    {
+        printf("Readahead (up to %d blocks): %lld prefetched in %lld refills, %.1f%% of reads served, "
+               "%lld unused\n",
+               readahead.maxWindow, device.prefetched, readahead.refills,
+               device.readRequests > 0 ? 100.0 * device.prefetchHits / device.readRequests : 0.0, readahead.discarded);
+        printf("Readahead latency hidden: %.3f s, prefetch I/O %.4f ms per block\n", device.hiddenMs / 1000,
+               device.prefetched > 0 ? device.prefetchMs / device.prefetched : 0.0);
+    }
+    if (device.store != NULL)
+    {
+        const struct BlockStore *store = device.store;
+        printf("Image (%s): %.1f MB read in %lld preads at %.1f MB/s, %.1f MB written in %lld pwrites at %.1f MB/s\n",
+               store->direct ? "direct I/O" : "page cache", store->readBytes / 1e6, store->readCalls,
+               store->readSeconds > 0 ? store->readBytes / store->readSeconds / 1e6 : 0.0, store->writeBytes / 1e6,
+               store->writeCalls, store->writeSeconds > 0 ? store->writeBytes / store->writeSeconds / 1e6 : 0.0);
+        printf("Image check: %lld blocks read back with the wrong stamp\n", store->mismatches);
+    }
+    printf("===============================================\n");
+}
+
+// Stream a trace file through the simulator with per-operation output
+// suppressed, then print timing. Returns -1 if the file cannot be read.
+int replayTrace(const char *path, const struct TraceHandlers *handlers)
+{
+    FILE *trace = fopen(path, "r");
+    if (trace == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    struct ReplayStats stats = {{0}, {0}, 0, 0};
+    struct TraceOp op;
+    char line[256];
+    long long lineNumber = 0;
+
+    consoleQuiet = 1;
+    double deviceStart = device.clockMs;
+    double start = wallSeconds();
+    while (fgets(line, sizeof(line), trace) != NULL)
+    {
+        lineNumber++;
+        int parsed = parseTraceLine(line, &op);
+        if (parsed == 1)
+        {
+            applyTraceOp(handlers, &op, &stats);
+        }
+        else if (parsed == -1)
+        {
+            fprintf(stderr, "%s:%lld: malformed operation skipped\n", path, lineNumber);
+        }
+    }
+    stats.seconds = wallSeconds() - start;
+    stats.deviceMs = device.clockMs - deviceStart;
+    consoleQuiet = 0;
+
+    fclose(trace);
+    printReplayStats(&stats);
+    return 0;
+}
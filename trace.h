@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_INSERT 0
+#define TRACE_DELETE 1
+#define TRACE_ACCESS 2
+#define TRACE_APPEND 3
+#define TRACE_OP_TYPES 4
+
+#define TRACE_NAME_MAX 64
+
+// One workload operation. 'value' is the block count for insert/append
+// and the block offset within the file for access.
+struct TraceOp
+{
+    int type;
+    char name[TRACE_NAME_MAX];
+    int value;
+};
+
+// A simulator's entry points. Each returns -1 on failure.
+struct TraceHandlers
+{
+    int (*insertFile)(const char *name, int blocks);
+    int (*deleteFile)(const char *name);
+    int (*accessFile)(const char *name, int offset);
+    int (*appendFile)(const char *name, int blocks);
+};
+
+struct ReplayStats
+{
+    long long count[TRACE_OP_TYPES];
+    long long failed[TRACE_OP_TYPES];
+    double seconds;  // Wall time spent applying operations
+    double deviceMs; // Simulated device time charged by those operations
+};
+
+int parseTraceLine(const char *line, struct TraceOp *op);
+int applyTraceOp(const struct TraceHandlers *handlers, const struct TraceOp *op, struct ReplayStats *stats);
+double wallSeconds(void);
+long long replayTotal(const struct ReplayStats *stats);
+void printReplayStats(const struct ReplayStats *stats);
+int replayTrace(const char *path, const struct TraceHandlers *handlers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
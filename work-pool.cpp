@@ -0,0 +1,76 @@
+#include <thread>
+
+#include "work-pool.hpp"
+
+namespace fsalloc
+{
+
+WorkPool::WorkPool(int workers)
+{
+    for (int i = 0; i < workers; i++)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+}
+
+// The worker's next task: its own newest, or else the oldest of the first
+// other worker that has any. Returns false once every deque is empty;
+// tasks never add tasks, so there is nothing left to wait for.
+bool WorkPool::next(int worker, size_t &task)
+{
+    {
+        Queue &own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t step = 1; step < queues.size(); step++)
+    {
+        Queue &victim = *queues[(worker + step) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            std::lock_guard<std::mutex> count(stealLock);
+            stealCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::run(size_t count, const std::function<void(size_t)> &task)
+{
+    size_t workerCount = queues.size();
+    for (size_t worker = 0; worker < workerCount; worker++)
+    {
+        // Pushed in reverse so the owner takes its range in order
+        for (size_t i = (worker + 1) * count / workerCount; i > worker * count / workerCount; i--)
+        {
+            queues[worker]->tasks.push_back(i - 1);
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t worker = 0; worker < workerCount; worker++)
+    {
+        threads.emplace_back([this, worker, &task]() {
+            size_t next;
+            while (this->next(static_cast<int>(worker), next))
+            {
+                task(next);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+} // namespace fsalloc
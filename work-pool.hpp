@@ -0,0 +1,46 @@
+#ifndef WORK_POOL_HPP
+#define WORK_POOL_HPP
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fsalloc
+{
+
+// Work-stealing thread pool for independent tasks. Each worker starts with
+// a contiguous range of the task numbers in its own deque and takes them
+// from the back; a worker whose deque is empty steals from the front of
+// another's, so a worker stuck with slow tasks hands the rest of its range
+// to idle ones.
+class WorkPool
+{
+public:
+    explicit WorkPool(int workers);
+
+    // Run task(i) for every i in [0, count) and return when all are done
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+    int workers() const { return static_cast<int>(queues.size()); }
+    long long steals() const { return stealCount; }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    bool next(int worker, size_t &task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    long long stealCount = 0;
+    std::mutex stealLock;
+};
+
+} // namespace fsalloc
+
+#endif
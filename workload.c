@@ -0,0 +1,303 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workload.h"
+
+#define FILL_GIVE_UP 64   // Consecutive failed inserts that end the fill phase
+#define APPEND_PERCENT 10 // Share of churn operations that append
+#define ZIPF_EXPONENT 1.0
+#define REPEAT_HOT_SHARE 16  // The repeat hot set holds 1/16 of the fill target
+#define REPEAT_SCAN_PERCENT 25 // Share of repeat reads that go to the scan
+#define SCAN_START_PERCENT 10  // Chance a scan workload operation starts reading a file
+
+static const char *workloadNames[WORKLOAD_KINDS] = {"fill", "churn", "large", "small", "zipf", "repeat", "scan"};
+
+int workloadKind(const char *name)
+{
+    for (int kind = 0; kind < WORKLOAD_KINDS; kind++)
+    {
+        if (strcmp(name, workloadNames[kind]) == 0)
+            return kind;
+    }
+    return -1;
+}
+
+const char *workloadName(int kind)
+{
+    return kind >= 0 && kind < WORKLOAD_KINDS ? workloadNames[kind] : "unknown";
+}
+
+static unsigned long long nextRandom(struct Workload *workload)
+{
+    // xorshift64*, fixed seed so every strategy sees the same stream
+    unsigned long long x = workload->seed;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    workload->seed = x;
+    return x * 2685821657736338717ULL;
+}
+
+// Uniform integer in [low, high]
+static int randomBetween(struct Workload *workload, int low, int high)
+{
+    return low + (int)(nextRandom(workload) % (unsigned long long)(high - low + 1));
+}
+
+static double randomUnit(struct Workload *workload)
+{
+    return (nextRandom(workload) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int workloadInit(struct Workload *workload, int kind, int diskBlocks, int fillPercent, long long operations)
+{
+    memset(workload, 0, sizeof(*workload));
+    workload->kind = kind;
+    workload->fillTarget = (int)((long long)diskBlocks * fillPercent / 100);
+    workload->remaining = kind == WORKLOAD_FILL ? 0 : operations;
+    workload->filling = 1;
+    workload->seed = 88172645463325252ULL;
+    workload->pendingIndex = -1;
+    workload->scanFile = -1;
+
+    switch (kind)
+    {
+    case WORKLOAD_LARGE:
+        workload->minBlocks = 256;
+        workload->maxBlocks = 4096;
+        break;
+    case WORKLOAD_SMALL:
+        workload->minBlocks = 1;
+        workload->maxBlocks = 4;
+        break;
+    default:
+        workload->minBlocks = 1;
+        workload->maxBlocks = 64;
+        break;
+    }
+    // Keep files well below the disk size on small disks
+    if (workload->maxBlocks > diskBlocks / 8)
+        workload->maxBlocks = diskBlocks / 8 > 0 ? diskBlocks / 8 : 1;
+    if (workload->minBlocks > workload->maxBlocks)
+        workload->minBlocks = workload->maxBlocks;
+
+    workload->liveCapacity = 1024;
+    workload->live = malloc(workload->liveCapacity * sizeof(struct LiveFile));
+    return workload->live != NULL ? 0 : -1;
+}
+
+void workloadDestroy(struct Workload *workload)
+{
+    free(workload->live);
+    free(workload->zipfCdf);
+    workload->live = NULL;
+    workload->zipfCdf = NULL;
+}
+
+static void makeName(struct TraceOp *op, int id)
+{
+    snprintf(op->name, TRACE_NAME_MAX, "w%d", id);
+}
+
+static void nextInsert(struct Workload *workload, struct TraceOp *op)
+{
+    op->type = TRACE_INSERT;
+    op->value = randomBetween(workload, workload->minBlocks, workload->maxBlocks);
+    makeName(op, workload->nextId++);
+}
+
+// Cumulative Zipf weights over the files alive when the access phase starts
+static int buildZipf(struct Workload *workload)
+{
+    workload->zipfCdf = malloc(workload->liveCount * sizeof(double));
+    if (workload->zipfCdf == NULL)
+        return -1;
+
+    double total = 0;
+    for (int rank = 0; rank < workload->liveCount; rank++)
+    {
+        total += 1.0 / pow(rank + 1, ZIPF_EXPONENT);
+        workload->zipfCdf[rank] = total;
+    }
+    for (int rank = 0; rank < workload->liveCount; rank++)
+        workload->zipfCdf[rank] /= total;
+    return 0;
+}
+
+// Next block of the repeat workload: mostly random blocks of the hot set,
+// with a sequential scan over the other files mixed in, so a cache sees
+// one-time blocks crowding out the blocks it will be asked for again
+static void nextRepeat(struct Workload *workload, struct TraceOp *op)
+{
+    if (workload->hotFiles == 0)
+    {
+        long long hotBlocks = 0;
+        while (workload->hotFiles < workload->liveCount &&
+               (workload->hotFiles == 0 || hotBlocks < workload->fillTarget / REPEAT_HOT_SHARE))
+        {
+            hotBlocks += workload->live[workload->hotFiles++].blocks;
+        }
+        workload->scanFile = workload->hotFiles;
+    }
+
+    op->type = TRACE_ACCESS;
+    if (workload->hotFiles < workload->liveCount && randomBetween(workload, 1, 100) <= REPEAT_SCAN_PERCENT)
+    {
+        struct LiveFile *file = &workload->live[workload->scanFile];
+        op->value = workload->scanOffset;
+        makeName(op, file->id);
+        if (++workload->scanOffset == file->blocks)
+        {
+            workload->scanOffset = 0;
+            workload->scanFile = workload->scanFile + 1 < workload->liveCount ? workload->scanFile + 1
+                                                                              : workload->hotFiles;
+        }
+        return;
+    }
+    struct LiveFile *file = &workload->live[randomBetween(workload, 0, workload->hotFiles - 1)];
+    op->value = randomBetween(workload, 0, file->blocks - 1);
+    makeName(op, file->id);
+}
+
+static int zipfRank(struct Workload *workload)
+{
+    double target = randomUnit(workload);
+    int low = 0, high = workload->liveCount - 1;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (workload->zipfCdf[middle] < target)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+// Produce the next operation. Returns 0 once the workload is finished.
+int workloadNext(struct Workload *workload, struct TraceOp *op)
+{
+    workload->pendingIndex = -1;
+    if (workload->filling)
+    {
+        if (workload->liveBlocks < workload->fillTarget && workload->fillFailures < FILL_GIVE_UP)
+        {
+            nextInsert(workload, op);
+            return 1;
+        }
+        workload->filling = 0;
+    }
+
+    if (workload->remaining <= 0)
+        return 0;
+    workload->remaining--;
+
+    if (workload->kind == WORKLOAD_ZIPF)
+    {
+        if (workload->liveCount == 0)
+            return 0;
+        if (workload->zipfCdf == NULL && buildZipf(workload) == -1)
+            return 0;
+        struct LiveFile *file = &workload->live[zipfRank(workload)];
+        op->type = TRACE_ACCESS;
+        op->value = randomBetween(workload, 0, file->blocks - 1);
+        makeName(op, file->id);
+        return 1;
+    }
+
+    if (workload->kind == WORKLOAD_REPEAT)
+    {
+        if (workload->liveCount == 0)
+            return 0;
+        nextRepeat(workload, op);
+        return 1;
+    }
+
+    // Scan: read one file block by block to its end, then churn a while
+    // before picking the next, so later files are read as churn left them
+    if (workload->kind == WORKLOAD_SCAN && workload->liveCount > 0 &&
+        (workload->scanFile != -1 || randomBetween(workload, 1, 100) <= SCAN_START_PERCENT))
+    {
+        if (workload->scanFile == -1)
+        {
+            workload->scanFile = randomBetween(workload, 0, workload->liveCount - 1);
+            workload->scanOffset = 0;
+        }
+        struct LiveFile *file = &workload->live[workload->scanFile];
+        op->type = TRACE_ACCESS;
+        op->value = workload->scanOffset;
+        makeName(op, file->id);
+        if (++workload->scanOffset == file->blocks)
+            workload->scanFile = -1;
+        return 1;
+    }
+
+    // Churn around the fill target: insert below it, delete above it or when
+    // the strategy's own overhead has filled the disk first
+    if (workload->liveCount == 0)
+    {
+        nextInsert(workload, op);
+    }
+    else if (randomBetween(workload, 1, 100) <= APPEND_PERCENT)
+    {
+        workload->pendingIndex = randomBetween(workload, 0, workload->liveCount - 1);
+        op->type = TRACE_APPEND;
+        op->value = randomBetween(workload, 1, workload->minBlocks > 8 ? workload->minBlocks : 8);
+        makeName(op, workload->live[workload->pendingIndex].id);
+    }
+    else if (workload->liveBlocks < workload->fillTarget && !workload->insertFailed)
+    {
+        nextInsert(workload, op);
+    }
+    else
+    {
+        workload->pendingIndex = randomBetween(workload, 0, workload->liveCount - 1);
+        op->type = TRACE_DELETE;
+        op->value = 0;
+        makeName(op, workload->live[workload->pendingIndex].id);
+    }
+    return 1;
+}
+
+// Record the simulator's answer to the operation last returned by workloadNext
+void workloadResult(struct Workload *workload, const struct TraceOp *op, int result)
+{
+    if (result == -1)
+    {
+        if (op->type == TRACE_INSERT && workload->filling)
+            workload->fillFailures++;
+        else if (op->type == TRACE_INSERT)
+            workload->insertFailed = 1;
+        return;
+    }
+
+    switch (op->type)
+    {
+    case TRACE_INSERT:
+        if (workload->liveCount == workload->liveCapacity)
+        {
+            struct LiveFile *grown = realloc(workload->live, 2 * workload->liveCapacity * sizeof(struct LiveFile));
+            if (grown == NULL)
+                return; // The file is simply never touched again
+            workload->live = grown;
+            workload->liveCapacity *= 2;
+        }
+        workload->live[workload->liveCount].id = atoi(op->name + 1);
+        workload->live[workload->liveCount].blocks = op->value;
+        workload->liveCount++;
+        workload->liveBlocks += op->value;
+        workload->fillFailures = 0;
+        break;
+    case TRACE_DELETE:
+        workload->insertFailed = 0;
+        workload->liveBlocks -= workload->live[workload->pendingIndex].blocks;
+        workload->live[workload->pendingIndex] = workload->live[--workload->liveCount];
+        break;
+    case TRACE_APPEND:
+        workload->live[workload->pendingIndex].blocks += op->value;
+        workload->liveBlocks += op->value;
+        break;
+    }
+}
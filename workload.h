@@ -0,0 +1,58 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WORKLOAD_FILL 0  // Insert files until the disk reaches the target utilization
+#define WORKLOAD_CHURN 1 // Fill, then delete/insert/append mixed-size files
+#define WORKLOAD_LARGE 2 // Fill and churn with large files
+#define WORKLOAD_SMALL 3 // Fill and churn with small files
+#define WORKLOAD_ZIPF 4  // Fill, then access files with Zipf-distributed popularity
+#define WORKLOAD_REPEAT 5 // Fill, then reread a hot set of files while a scan walks the rest
+#define WORKLOAD_SCAN 6   // Churn while reading whole files from start to end
+#define WORKLOAD_KINDS 7
+
+struct LiveFile
+{
+    int id;
+    int blocks;
+};
+
+// Synthetic operation stream. The generator is told each result so it only
+// deletes, appends to and accesses files that really exist.
+struct Workload
+{
+    int kind;
+    int fillTarget;      // Blocks in live files before the measured phase
+    long long remaining; // Operations left in the measured phase
+    int filling;         // 1 while in the fill phase
+    int fillFailures;    // Consecutive failed inserts during fill
+    int insertFailed;    // Last churn insert failed, delete before retrying
+    int minBlocks, maxBlocks;
+    struct LiveFile *live;
+    int liveCount, liveCapacity;
+    long long liveBlocks;
+    int nextId;
+    int pendingIndex; // Live file targeted by the last delete/append
+    double *zipfCdf; // Built when the Zipf access phase starts
+    int hotFiles;    // Repeat: live[0..hotFiles) is the hot set, 0 until chosen
+    int scanFile, scanOffset; // Block the sequential reader reads next, scanFile -1 if none
+    unsigned long long seed;
+};
+
+int workloadKind(const char *name);
+const char *workloadName(int kind);
+int workloadInit(struct Workload *workload, int kind, int diskBlocks, int fillPercent, long long operations);
+void workloadDestroy(struct Workload *workload);
+int workloadNext(struct Workload *workload, struct TraceOp *op);
+void workloadResult(struct Workload *workload, const struct TraceOp *op, int result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif